@@ -0,0 +1,340 @@
+#include "BatchGeneration.h"
+#include "SignatureUtils.h"
+#include <algorithm>
+#include <charconv>
+#include <format>
+#include <fstream>
+#include <map>
+
+// Shard files keep values and masks in hex, so bit-level wildcards survive until the merge formats them
+static constexpr std::string_view SHARD_HEADER = "# SigMaker shard";
+static constexpr std::string_view SHARD_COMPLETE = "# complete";
+
+template <typename T>
+static bool ParseNumber( std::string_view text, T& value, int base = 10 ) {
+    const auto result = std::from_chars( text.data( ), text.data( ) + text.size( ), value, base );
+    return result.ec == std::errc( ) && result.ptr == text.data( ) + text.size( );
+}
+
+std::expected<BatchOptions, std::string> ParseBatchOptions( std::string_view optionString ) {
+    BatchOptions options;
+    bool hasShard = false;
+    size_t start = 0;
+    while( start <= optionString.size( ) ) {
+        auto end = optionString.find( ',', start );
+        if( end == std::string_view::npos ) {
+            end = optionString.size( );
+        }
+        const auto option = optionString.substr( start, end - start );
+        start = end + 1;
+        if( option.empty( ) ) {
+            continue;
+        }
+
+        const auto separator = option.find( '=' );
+        const auto key = option.substr( 0, separator );
+        const auto value = separator == std::string_view::npos ? std::string_view( ) : option.substr( separator + 1 );
+        if( key == "shard" ) {
+            const auto slash = value.find( '/' );
+            if( slash == std::string_view::npos || !ParseNumber( value.substr( 0, slash ), options.shardIndex ) || !ParseNumber( value.substr( slash + 1 ), options.shardCount ) ||
+                options.shardCount == 0 || options.shardIndex >= options.shardCount ) {
+                return std::unexpected( std::format( "Invalid shard \"{}\", expected <index>/<count> with index below count", value ) );
+            }
+            hasShard = true;
+        }
+        else if( key == "merge" ) {
+            if( !ParseNumber( value, options.shardCount ) || options.shardCount == 0 ) {
+                return std::unexpected( std::format( "Invalid shard count \"{}\" to merge", value ) );
+            }
+            options.merge = true;
+        }
+        else if( key == "by" ) {
+            if( value == "functions" ) {
+                options.shardMode = ShardMode::Functions;
+            }
+            else if( value == "range" ) {
+                options.shardMode = ShardMode::Range;
+            }
+            else {
+                return std::unexpected( std::format( "Unknown shard mode \"{}\"", value ) );
+            }
+        }
+        else if( key == "out" ) {
+            options.outputPath = value;
+        }
+        else if( key == "format" ) {
+            constexpr std::pair<std::string_view, SignatureType> formats[] = {
+                { "ida", SignatureType::IDA }, { "x64dbg", SignatureType::x64Dbg }, { "mask", SignatureType::Signature_Mask },
+                { "bitmask", SignatureType::SignatureByteArray_Bitmask }, { "cpp", SignatureType::CppPattern },
+            };
+            const auto format = std::ranges::find( formats, value, &std::pair<std::string_view, SignatureType>::first );
+            if( format == std::end( formats ) ) {
+                return std::unexpected( std::format( "Unknown format \"{}\"", value ) );
+            }
+            options.outputType = format->second;
+        }
+        else if( key == "maxlength" ) {
+            if( !ParseNumber( value, options.maxSignatureLength ) ) {
+                return std::unexpected( std::format( "Invalid maximum length \"{}\"", value ) );
+            }
+        }
+        else if( key == "budget" ) {
+            if( !ParseNumber( value, options.timeBudgetMs ) ) {
+                return std::unexpected( std::format( "Invalid time budget \"{}\"", value ) );
+            }
+        }
+        else if( key == "deadline" ) {
+            if( !ParseNumber( value, options.deadlineSeconds ) ) {
+                return std::unexpected( std::format( "Invalid deadline \"{}\"", value ) );
+            }
+        }
+        else if( key == "pages" ) {
+            if( value == "transparent" ) {
+                options.memoryPlacement.largePages = LargePages::Transparent;
+            }
+            else if( value == "large" ) {
+                options.memoryPlacement.largePages = LargePages::Explicit;
+            }
+            else {
+                return std::unexpected( std::format( "Unknown page size \"{}\"", value ) );
+            }
+        }
+        else if( key == "numa" ) {
+            if( value == "interleave" ) {
+                options.memoryPlacement.numa = NumaPlacement::Interleaved;
+            }
+            else if( value == "firsttouch" ) {
+                options.memoryPlacement.numa = NumaPlacement::FirstTouch;
+            }
+            else {
+                return std::unexpected( std::format( "Unknown NUMA placement \"{}\"", value ) );
+            }
+            // Placement only pays off if each node's workers scan its stripes
+            options.parallelScan = true;
+        }
+        else if( key == "threads" ) {
+            if( value == "all" ) {
+                options.threadsPerNode = 0;
+            }
+            else if( !ParseNumber( value, options.threadsPerNode ) || options.threadsPerNode == 0 ) {
+                return std::unexpected( std::format( "Invalid thread count \"{}\"", value ) );
+            }
+            options.parallelScan = true;
+        }
+        else if( key == "noexit" ) {
+            options.noExit = true;
+        }
+        else {
+            return std::unexpected( std::format( "Unknown option \"{}\"", key ) );
+        }
+    }
+
+    if( hasShard == options.merge ) {
+        return std::unexpected( "Either shard=<index>/<count> or merge=<count> is required" );
+    }
+    if( options.outputPath.empty( ) ) {
+        return std::unexpected( "Missing out=<path>" );
+    }
+    return options;
+}
+
+std::string GetShardPath( const BatchOptions& options, size_t shardIndex ) {
+    return std::format( "{}.shard{}", options.outputPath, shardIndex );
+}
+
+std::vector<uint64_t> SelectShardAddresses( std::span<const uint64_t> functionStarts, const BatchOptions& options ) {
+    std::vector<uint64_t> addresses;
+    if( functionStarts.empty( ) ) {
+        return addresses;
+    }
+
+    if( options.shardMode == ShardMode::Functions ) {
+        const auto begin = functionStarts.size( ) * options.shardIndex / options.shardCount;
+        const auto end = functionStarts.size( ) * ( options.shardIndex + 1 ) / options.shardCount;
+        addresses.assign( functionStarts.begin( ) + begin, functionStarts.begin( ) + end );
+        return addresses;
+    }
+
+    // Split the span between the lowest and highest function start, the last shard includes the highest one
+    const auto [minEA, maxEA] = std::ranges::minmax( functionStarts );
+    const uint64_t span = maxEA - minEA + 1;
+    // span * index / count without overflowing
+    auto boundary = [&]( size_t index ) {
+        return minEA + span / options.shardCount * index + span % options.shardCount * index / options.shardCount;
+    };
+    const auto rangeStart = boundary( options.shardIndex );
+    const auto rangeEnd = boundary( options.shardIndex + 1 );
+    for( const auto ea : functionStarts ) {
+        if( ea >= rangeStart && ea < rangeEnd ) {
+            addresses.push_back( ea );
+        }
+    }
+    return addresses;
+}
+
+std::expected<BatchResult, std::string> GenerateShard( const Database& database, std::span<const uint64_t> addresses, const BatchOptions& options, const GeneratorOptions& generatorOptions ) {
+    const auto path = GetShardPath( options, options.shardIndex );
+    std::ofstream file( path, std::ios::trunc );
+    if( !file.is_open( ) ) {
+        return std::unexpected( std::format( "Failed to create {}", path ) );
+    }
+    file << std::format( "{} {}/{}, {} addresses\n", SHARD_HEADER, options.shardIndex, options.shardCount, addresses.size( ) );
+
+    CancelToken jobToken( generatorOptions.jobToken );
+    if( options.deadlineSeconds > 0 ) {
+        jobToken.SetBudget( std::chrono::seconds( options.deadlineSeconds ) );
+    }
+    auto shardOptions = generatorOptions;
+    shardOptions.timeBudgetMs = options.timeBudgetMs;
+    shardOptions.jobToken = &jobToken;
+
+    BatchResult result;
+    Signature signature;
+    std::string line;
+    for( size_t i = 0; i < addresses.size( ); i++ ) {
+        if( generatorOptions.isCancelled && generatorOptions.isCancelled( ) ) {
+            return std::unexpected( "Aborted" );
+        }
+        if( jobToken.IsPastDeadline( ) ) {
+            if( generatorOptions.log ) {
+                generatorOptions.log( std::format( "Shard {}/{}: deadline reached after {} of {} addresses\n", options.shardIndex, options.shardCount, i, addresses.size( ) ) );
+            }
+            file << std::format( "# deadline reached, {} addresses skipped\n", addresses.size( ) - i );
+            result.failed += addresses.size( ) - i;
+            break;
+        }
+        if( generatorOptions.log && i % 1000 == 0 ) {
+            generatorOptions.log( std::format( "Shard {}/{}: {} of {} addresses\n", options.shardIndex, options.shardCount, i, addresses.size( ) ) );
+        }
+
+        if( !GenerateUniqueSignatureForEA( database, addresses[i], shardOptions, signature ).has_value( ) ) {
+            result.failed++;
+            continue;
+        }
+
+        // "<address> <values> <masks>"
+        line = std::format( "{:X} ", addresses[i] );
+        for( const auto& byte : signature ) {
+            line += std::format( "{:02X}", byte.isWildcard ? 0 : byte.value & byte.mask );
+        }
+        line += ' ';
+        for( const auto& byte : signature ) {
+            line += std::format( "{:02X}", GetMatchMask( byte ) );
+        }
+        line += '\n';
+        file << line;
+        result.signatures++;
+    }
+
+    // Lets the merge tell finished shards from ones whose process died
+    file << SHARD_COMPLETE << '\n';
+    file.close( );
+    if( file.fail( ) ) {
+        return std::unexpected( std::format( "Failed to write {}", path ) );
+    }
+    return result;
+}
+
+static bool ParseShardLine( std::string_view line, uint64_t& ea, Signature& signature ) {
+    const auto first = line.find( ' ' );
+    const auto second = line.find( ' ', first + 1 );
+    if( first == std::string_view::npos || second == std::string_view::npos || !ParseNumber( line.substr( 0, first ), ea, 16 ) ) {
+        return false;
+    }
+    const auto values = line.substr( first + 1, second - first - 1 );
+    const auto masks = line.substr( second + 1 );
+    if( values.size( ) != masks.size( ) || values.size( ) % 2 != 0 || values.empty( ) ) {
+        return false;
+    }
+
+    signature.clear( );
+    for( size_t i = 0; i < values.size( ); i += 2 ) {
+        uint8_t value = 0, mask = 0;
+        if( !ParseNumber( values.substr( i, 2 ), value, 16 ) || !ParseNumber( masks.substr( i, 2 ), mask, 16 ) ) {
+            return false;
+        }
+        SignatureByte byte{ value, mask == 0 };
+        byte.mask = mask == 0 ? 0xFF : mask;
+        signature.push_back( byte );
+    }
+    return true;
+}
+
+std::expected<BatchResult, std::string> MergeShards( const Database& database, const BatchOptions& options, const std::function<void( std::string_view message )>& log ) {
+    auto print = [&]( std::string message ) {
+        if( log ) {
+            log( message );
+        }
+    };
+
+    // Read every shard, the shorter signature wins if shards overlap
+    std::map<uint64_t, Signature> signatures;
+    for( size_t shardIndex = 0; shardIndex < options.shardCount; shardIndex++ ) {
+        const auto path = GetShardPath( options, shardIndex );
+        std::ifstream file( path );
+        if( !file.is_open( ) ) {
+            return std::unexpected( std::format( "Missing shard file {}", path ) );
+        }
+
+        std::string line;
+        bool isComplete = false;
+        while( std::getline( file, line ) ) {
+            if( line.starts_with( '#' ) ) {
+                isComplete |= line == SHARD_COMPLETE;
+                continue;
+            }
+
+            uint64_t ea = 0;
+            Signature signature;
+            if( !ParseShardLine( line, ea, signature ) ) {
+                return std::unexpected( std::format( "Malformed line in {}: {}", path, line ) );
+            }
+            if( const auto it = signatures.find( ea ); it == signatures.end( ) || signature.size( ) < it->second.size( ) ) {
+                signatures[ea] = std::move( signature );
+            }
+        }
+        if( !isComplete ) {
+            return std::unexpected( std::format( "Shard file {} is incomplete, its process did not finish", path ) );
+        }
+    }
+
+    // The same signature found for several addresses matches all of them
+    std::map<std::string, size_t> signatureCounts;
+    auto signatureKey = []( const Signature& signature ) {
+        std::string key;
+        for( const auto& byte : signature ) {
+            key += static_cast<char>( byte.isWildcard ? 0 : byte.value & byte.mask );
+            key += static_cast<char>( GetMatchMask( byte ) );
+        }
+        return key;
+    };
+    for( const auto& [ea, signature] : signatures ) {
+        signatureCounts[signatureKey( signature )]++;
+    }
+
+    SignatureFileWriter writer;
+    if( !writer.Open( options.outputPath ) ) {
+        return std::unexpected( std::format( "Failed to create {}", options.outputPath ) );
+    }
+
+    BatchResult result;
+    for( const auto& [ea, signature] : signatures ) {
+        // Re-check against the whole database, shards may come from processes that saw different patches
+        if( signatureCounts[signatureKey( signature )] > 1 ) {
+            print( std::format( "Conflict: signature for {:X} was also generated for another address\n", ea ) );
+            result.conflicts++;
+            continue;
+        }
+        if( const auto matches = database.FindOccurences( signature, 2 ); matches.size( ) != 1 || matches.front( ) != ea ) {
+            print( std::format( "Conflict: signature for {:X} matches {} times\n", ea, matches.size( ) ) );
+            result.conflicts++;
+            continue;
+        }
+        writer.Write( ea, signature, options.outputType );
+        result.signatures++;
+    }
+    if( !writer.Close( ) ) {
+        return std::unexpected( std::format( "Failed to write {}", options.outputPath ) );
+    }
+    return result;
+}
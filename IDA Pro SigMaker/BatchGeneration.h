@@ -0,0 +1,59 @@
+#pragma once
+#include "SignatureGenerator.h"
+#include <expected>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+
+// How the functions of a database are split between processes
+enum class ShardMode : uint32_t {
+    Functions = 0, // Contiguous runs of the function list, equally many functions per shard
+    Range          // Equally large address ranges, by function start
+};
+
+// Settings of one batch process, parsed from e.g. "shard=3/16,out=C:\sigs\all.sig"
+struct BatchOptions {
+    // Generate shard `shardIndex` of `shardCount`, or merge `shardCount` shard files if merge is set
+    size_t shardIndex = 0;
+    size_t shardCount = 1;
+    bool merge = false;
+    ShardMode shardMode = ShardMode::Functions;
+    // Merged output. Shards write to "<outputPath>.shard<index>"
+    std::string outputPath;
+    SignatureType outputType = SignatureType::IDA;
+    size_t maxSignatureLength = 250;
+    // Time per address in milliseconds and for the whole shard in seconds, 0 for none
+    size_t timeBudgetMs = 0;
+    size_t deadlineSeconds = 0;
+    // Segment copy placement, and workers per NUMA node that scan it in parallel. 0 for one per processor
+    MemoryPlacement memoryPlacement;
+    bool parallelScan = false;
+    size_t threadsPerNode = 0;
+    // Keep IDA open when done
+    bool noExit = false;
+};
+
+struct BatchResult {
+    size_t signatures = 0;
+    size_t failed = 0;
+    // Merge only: signatures dropped because they are not unique anymore, or were found for several addresses
+    size_t conflicts = 0;
+};
+
+// Comma separated key=value pairs: shard=<index>/<count>, merge=<count>, by=functions|range, out=<path>,
+// format=ida|x64dbg|mask|bitmask|cpp, maxlength=<bytes>, budget=<ms per address>, deadline=<seconds per shard>,
+// pages=transparent|large, numa=interleave|firsttouch, threads=<per node>|all, noexit. numa implies threads=all
+std::expected<BatchOptions, std::string> ParseBatchOptions( std::string_view optionString );
+
+std::string GetShardPath( const BatchOptions& options, size_t shardIndex );
+
+// Function starts that belong to the shard
+std::vector<uint64_t> SelectShardAddresses( std::span<const uint64_t> functionStarts, const BatchOptions& options );
+
+// Generate a signature for every address and write them to the shard file
+// Once the deadline passes, the remaining addresses are counted as failed and the shard is completed with what it has
+std::expected<BatchResult, std::string> GenerateShard( const Database& database, std::span<const uint64_t> addresses, const BatchOptions& options, const GeneratorOptions& generatorOptions );
+
+// Combine all shard files into the output, re-checking that every signature still matches exactly its own address in the database
+std::expected<BatchResult, std::string> MergeShards( const Database& database, const BatchOptions& options, const std::function<void( std::string_view message )>& log );
@@ -0,0 +1,249 @@
+#include "Benchmark.h"
+#include "SignatureGenerator.h"
+#include "SignatureUtils.h"
+#include "StandInDatabase.h"
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <random>
+
+using BenchmarkClock = std::chrono::steady_clock;
+
+struct PatternShape {
+    const char* name;
+    // Returns an empty signature if no pattern could be built at the address
+    std::function<Signature( const Database& database, uint64_t ea )> build;
+    size_t limit;
+};
+
+static double SecondsSince( BenchmarkClock::time_point start ) {
+    return std::chrono::duration<double>( BenchmarkClock::now( ) - start ).count( );
+}
+
+static Signature ReadPattern( const Database& database, uint64_t ea, size_t leadingWildcards, size_t length ) {
+    Signature signature( leadingWildcards, SignatureByte{ 0, true } );
+    std::vector<uint8_t> bytes( length );
+    if( database.ReadBytes( ea, bytes.data( ), length ) != length ) {
+        return {};
+    }
+    for( const auto byte : bytes ) {
+        signature.push_back( { byte, false } );
+    }
+    return signature;
+}
+
+static std::vector<PatternShape> GetPatternShapes( uint32_t operandTypeBitmask ) {
+    return {
+        { "solid 16", []( const Database& database, uint64_t ea ) { return ReadPattern( database, ea, 0, 16 ); }, 2 },
+        { "leading wildcards", []( const Database& database, uint64_t ea ) { return ReadPattern( database, ea, 4, 12 ); }, 2 },
+        { "operand wildcards", [operandTypeBitmask]( const Database& database, uint64_t ea ) {
+            GeneratorOptions options;
+            options.operandTypeBitmask = operandTypeBitmask;
+            return GenerateSignatureForEARange( database, ea, ea + 32, options ).value_or( Signature{ } );
+        }, 2 },
+        { "bit wildcards", [operandTypeBitmask]( const Database& database, uint64_t ea ) {
+            GeneratorOptions options;
+            options.operandTypeBitmask = operandTypeBitmask;
+            options.wildcardGranularity = WildcardGranularity::Bit;
+            return GenerateSignatureForEARange( database, ea, ea + 32, options ).value_or( Signature{ } );
+        }, 2 },
+        { "short, all hits", []( const Database& database, uint64_t ea ) { return ReadPattern( database, ea, 0, 3 ); }, std::numeric_limits<size_t>::max( ) },
+    };
+}
+
+void RunBenchmark( Database& database, std::string_view name, std::span<const uint64_t> codeAddresses, const BenchmarkOptions& options ) {
+    if( codeAddresses.empty( ) || !options.print ) {
+        return;
+    }
+
+    const auto previousEngine = database.scanEngine;
+    const auto imageSize = database.GetSegmentBuffer( ).data.size( );
+    options.print( std::format( "Benchmark for {} ({:.1f} MiB, {} code addresses)\n", name, imageSize / ( 1024.0 * 1024.0 ), codeAddresses.size( ) ) );
+
+    // Sample the same addresses for every engine
+    std::mt19937_64 random( options.seed );
+    auto sample = [&]( size_t count ) {
+        std::vector<uint64_t> addresses( count );
+        for( auto& ea : addresses ) {
+            ea = codeAddresses[random( ) % codeAddresses.size( )];
+        }
+        return addresses;
+    };
+
+    // Uniqueness checks per pattern shape
+    for( const auto& shape : GetPatternShapes( options.operandTypeBitmask ) ) {
+        std::vector<Signature> patterns;
+        for( const auto ea : sample( options.uniquenessChecks ) ) {
+            if( auto pattern = shape.build( database, ea ); !pattern.empty( ) ) {
+                patterns.push_back( std::move( pattern ) );
+            }
+        }
+        if( patterns.empty( ) ) {
+            continue;
+        }
+
+        for( const auto engine : options.engines ) {
+            database.scanEngine = engine;
+            size_t hits = 0;
+            const auto start = BenchmarkClock::now( );
+            for( const auto& pattern : patterns ) {
+                hits += database.FindOccurences( pattern, shape.limit ).size( );
+            }
+            const auto seconds = SecondsSince( start );
+            options.print( std::format( "  {:<12} search {:<18} {:>6} patterns {:>10.1f} us/pattern {:>9.1f} MB/s (upper bound) {:>9} hits\n",
+                GetScanEngineName( engine ), shape.name, patterns.size( ), seconds * 1e6 / patterns.size( ), ( imageSize * patterns.size( ) ) / ( seconds * 1e6 ), hits ) );
+        }
+    }
+
+    // Single signature generation and xref-style bulk generation
+    const auto singleAddresses = sample( options.generatedSignatures );
+    const auto bulkAddresses = sample( options.bulkSignatures );
+    auto generate = [&]( const char* label, const std::vector<uint64_t>& addresses, size_t maxSignatureLength, bool sharePrefixes ) {
+        GeneratorOptions generatorOptions;
+        generatorOptions.operandTypeBitmask = options.operandTypeBitmask;
+        generatorOptions.continueOutsideOfFunction = true;
+        generatorOptions.maxSignatureLength = maxSignatureLength;
+
+        for( const auto engine : options.engines ) {
+            database.scanEngine = engine;
+            size_t unique = 0, totalLength = 0;
+            Signature signature;
+            const auto start = BenchmarkClock::now( );
+            if( sharePrefixes ) {
+                GenerateUniqueSignaturesForEAs( database, addresses, generatorOptions, [&]( size_t, const std::expected<Signature, std::string>& result ) {
+                    if( result.has_value( ) ) {
+                        unique++;
+                        totalLength += result->size( );
+                    }
+                } );
+            }
+            else {
+                for( const auto ea : addresses ) {
+                    if( GenerateUniqueSignatureForEA( database, ea, generatorOptions, signature ).has_value( ) ) {
+                        unique++;
+                        totalLength += signature.size( );
+                    }
+                }
+            }
+            const auto seconds = SecondsSince( start );
+            options.print( std::format( "  {:<12} {:<25} {:>6} addresses {:>10.2f} ms/signature {:>6} unique, avg {:.1f} bytes\n",
+                GetScanEngineName( engine ), label, addresses.size( ), seconds * 1e3 / addresses.size( ), unique, unique ? static_cast<double>( totalLength ) / unique : 0.0 ) );
+        }
+    };
+    generate( "generate single", singleAddresses, options.maxSignatureLength, false );
+    generate( "generate xref-style bulk", bulkAddresses, options.maxBulkSignatureLength, false );
+    generate( "generate bulk prefix trie", bulkAddresses, options.maxBulkSignatureLength, true );
+
+    // Parallel full scans of copies placed differently, with throughput per NUMA node. On common servers a node is a socket
+    if( options.comparePlacements ) {
+        struct PlacementVariant {
+            const char* name;
+            MemoryPlacement placement;
+        };
+        constexpr PlacementVariant variants[] = {
+            { "default", { } },
+            { "interleaved", { LargePages::None, NumaPlacement::Interleaved } },
+            { "first touch", { LargePages::None, NumaPlacement::FirstTouch } },
+            { "large pages", { LargePages::Explicit, NumaPlacement::None } },
+            { "large, interleaved", { LargePages::Explicit, NumaPlacement::Interleaved } },
+            { "large, first touch", { LargePages::Explicit, NumaPlacement::FirstTouch } },
+        };
+        // Every hit of a common pattern, so the whole buffer is scanned
+        const auto pattern = ReadPattern( database, codeAddresses[random( ) % codeAddresses.size( )], 0, 4 );
+        // Repeat on small images until about 256 MiB are scanned
+        const size_t repeats = std::clamp<size_t>( ( 256 << 20 ) / std::max<size_t>( imageSize, 1 ), 1, 64 );
+
+        NodeWorkers workers( options.threadsPerNode );
+        for( const auto& variant : variants ) {
+            if( pattern.empty( ) || ( workers.NodeCount( ) == 1 && variant.placement.numa != NumaPlacement::None ) ) {
+                continue;
+            }
+            const auto copy = CopySegmentBuffer( database.GetSegmentBuffer( ), variant.placement );
+            std::vector<size_t> nodeBytes( workers.NodeCount( ), 0 );
+            for( size_t offset = 0; offset < copy.data.size( ); offset += SCAN_CHUNK_SIZE ) {
+                nodeBytes[copy.data.GetNode( offset ) % nodeBytes.size( )] += std::min( SCAN_CHUNK_SIZE, copy.data.size( ) - offset );
+            }
+
+            for( const auto engine : options.engines ) {
+                if( engine == ScanEngine::Native ) {
+                    continue;
+                }
+                size_t hits = 0;
+                const auto start = BenchmarkClock::now( );
+                for( size_t repeat = 0; repeat < repeats; repeat++ ) {
+                    hits += FindSignatureOccurencesInBufferParallel( copy, pattern, engine, workers ).size( );
+                }
+                const auto seconds = SecondsSince( start );
+                auto line = std::format( "  {:<12} parallel {:<18} {:<11} {:>4} threads {:>9.1f} MB/s {:>9} hits", GetScanEngineName( engine ), variant.name,
+                    copy.data.HasLargePages( ) ? "large pages" : "", workers.ThreadCount( ), imageSize * repeats / ( seconds * 1e6 ), hits / repeats );
+                for( size_t node = 0; node < nodeBytes.size( ); node++ ) {
+                    line += std::format( " | node {} {:.1f} MB/s", node, nodeBytes[node] * repeats / ( seconds * 1e6 ) );
+                }
+                options.print( line + "\n" );
+            }
+        }
+
+        // Uniqueness checks as signature generation runs them while growing, short prefixes find their second match within a few bytes
+        std::vector<Signature> checks;
+        for( size_t i = 0; i < options.uniquenessChecks; i++ ) {
+            if( auto check = ReadPattern( database, codeAddresses[random( ) % codeAddresses.size( )], 0, 2 + i % 7 ); !check.empty( ) ) {
+                checks.push_back( std::move( check ) );
+            }
+        }
+        const auto& buffer = database.GetSegmentBuffer( );
+        for( const auto engine : options.engines ) {
+            if( engine == ScanEngine::Native || checks.empty( ) ) {
+                continue;
+            }
+            size_t serialHits = 0, parallelHits = 0;
+            auto start = BenchmarkClock::now( );
+            for( const auto& check : checks ) {
+                serialHits += FindSignatureOccurencesInBuffer( buffer, check, engine, 2 ).size( );
+            }
+            const auto serialSeconds = SecondsSince( start );
+            start = BenchmarkClock::now( );
+            for( const auto& check : checks ) {
+                parallelHits += FindSignatureOccurencesInBufferParallel( buffer, check, engine, workers, 2 ).size( );
+            }
+            const auto parallelSeconds = SecondsSince( start );
+            options.print( std::format( "  {:<12} limit 2 checks     {:>6} patterns {:>10.1f} us/pattern serial {:>10.1f} us/pattern parallel {:>6} hits{}\n", GetScanEngineName( engine ),
+                checks.size( ), serialSeconds * 1e6 / checks.size( ), parallelSeconds * 1e6 / checks.size( ), serialHits, parallelHits == serialHits ? "" : ", parallel hits differ" ) );
+        }
+    }
+
+    // Formatting for bulk export, into one reused buffer
+    std::vector<Signature> exportSignatures;
+    for( const auto ea : bulkAddresses ) {
+        GeneratorOptions generatorOptions;
+        generatorOptions.operandTypeBitmask = options.operandTypeBitmask;
+        if( auto signature = GenerateSignatureForEARange( database, ea, ea + 32, generatorOptions ); signature.has_value( ) ) {
+            exportSignatures.push_back( std::move( signature.value( ) ) );
+        }
+    }
+    if( !exportSignatures.empty( ) ) {
+        constexpr const char* typeNames[] = { "IDA", "x64Dbg", "string mask", "bitmask", "C++ pattern" };
+        std::vector<char> buffer( 4096 );
+        for( size_t type = 0; type < std::size( typeNames ); type++ ) {
+            size_t characters = 0;
+            const auto start = BenchmarkClock::now( );
+            for( size_t repeat = 0; repeat < 20; repeat++ ) {
+                for( const auto& signature : exportSignatures ) {
+                    characters += FormatSignatureTo( buffer.data( ), buffer.size( ), signature, static_cast<SignatureType>( type ), 0 );
+                }
+            }
+            const auto seconds = SecondsSince( start );
+            options.print( std::format( "  format {:<21} {:>6} signatures {:>10.1f} ns/signature {:>9.1f} MB/s\n",
+                typeNames[type], exportSignatures.size( ), seconds * 1e9 / ( exportSignatures.size( ) * 20 ), characters / ( seconds * 1e6 ) ) );
+        }
+    }
+
+    database.scanEngine = previousEngine;
+}
+
+void RunSyntheticBenchmarks( std::span<const size_t> imageSizes, const BenchmarkOptions& options ) {
+    for( const auto size : imageSizes ) {
+        auto database = CreateSyntheticDatabase( size, options.seed );
+        const auto addresses = database->GetInstructionAddresses( std::numeric_limits<size_t>::max( ) );
+        RunBenchmark( *database, std::format( "synthetic {} KiB", size / 1024 ), addresses, options );
+    }
+}
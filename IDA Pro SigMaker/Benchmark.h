@@ -0,0 +1,28 @@
+#pragma once
+#include "Database.h"
+#include <functional>
+#include <span>
+#include <string_view>
+
+struct BenchmarkOptions {
+    // Every engine runs on the same inputs
+    std::vector<ScanEngine> engines;
+    size_t uniquenessChecks = 200;
+    size_t generatedSignatures = 50;
+    size_t bulkSignatures = 500;
+    size_t maxSignatureLength = 1000;
+    size_t maxBulkSignatureLength = 250;
+    uint32_t operandTypeBitmask = 0xFFFFFFFF;
+    uint64_t seed = 1337;
+    // Parallel full scans of copies with each page and NUMA placement and parallel limit 2 checks, 0 threads per node starts one per processor
+    bool comparePlacements = true;
+    size_t threadsPerNode = 0;
+    std::function<void( std::string_view line )> print;
+};
+
+// Time uniqueness checks per pattern shape, signature generation, xref-style bulk generation and parallel scans per NUMA node on the database
+// Addresses are sampled from codeAddresses
+void RunBenchmark( Database& database, std::string_view name, std::span<const uint64_t> codeAddresses, const BenchmarkOptions& options );
+
+// Run the benchmark on synthetic stand-in images of the given sizes
+void RunSyntheticBenchmarks( std::span<const size_t> imageSizes, const BenchmarkOptions& options );
@@ -0,0 +1,109 @@
+// Command line benchmark and verification of the IDA-free core, built by CMakeLists.txt without the IDA SDK
+//
+//   sigmaker_bench [image...]           benchmark on synthetic images and the given PE/ELF files
+//   sigmaker_bench --verify [image...]  x86 decoder, SigMakerPattern.hpp, ShortestSignatures and differential scan engine checks, exits with 1 on any mismatch
+#include "Benchmark.h"
+#include "StandInDatabase.h"
+#include "Verification.h"
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#endif
+
+static bool HasAVX2( ) {
+#ifdef _WIN32
+    return IsProcessorFeaturePresent( PF_AVX2_INSTRUCTIONS_AVAILABLE );
+#else
+    return __builtin_cpu_supports( "avx2" );
+#endif
+}
+
+static void Print( std::string_view line ) {
+    std::fwrite( line.data( ), 1, line.size( ), stdout );
+    std::fflush( stdout );
+}
+
+static void PrintUsage( ) {
+    Print( "Usage: sigmaker_bench [--verify] [image...]\n"
+           "  Benchmarks the scan engines and signature generation on synthetic images of 1, 16 and 64 MiB and on the given PE/ELF images\n"
+           "  --verify  Check the x86 decoder on known encodings, SigMakerPattern.hpp, ShortestSignatures and every scan engine against the reference scanner instead,\n"
+           "            exits with 1 on any mismatch\n" );
+}
+
+int main( int argc, char** argv ) {
+    bool verify = false;
+    std::vector<std::string> imagePaths;
+    for( int i = 1; i < argc; i++ ) {
+        const std::string_view argument = argv[i];
+        if( argument == "--verify" ) {
+            verify = true;
+        }
+        else if( argument.starts_with( '-' ) ) {
+            PrintUsage( );
+            return argument == "--help" || argument == "-h" ? 0 : 2;
+        }
+        else {
+            imagePaths.emplace_back( argument );
+        }
+    }
+
+    // The native search of stand-in images is the reference scanner
+    std::vector<ScanEngine> engines = { ScanEngine::Reference, ScanEngine::Masked };
+    if( HasAVX2( ) ) {
+        engines.push_back( ScanEngine::Qis );
+    }
+
+    std::vector<std::unique_ptr<StandInDatabase>> images;
+    for( const auto& path : imagePaths ) {
+        auto image = LoadStandInImage( path );
+        if( image == nullptr ) {
+            Print( "Failed to read " + path + "\n" );
+            return 2;
+        }
+        images.push_back( std::move( image ) );
+    }
+
+    if( verify ) {
+        VerificationOptions options;
+        options.engines = engines;
+        std::erase( options.engines, ScanEngine::Reference );
+        options.print = Print;
+
+        auto result = VerifyX86DecoderOnKnownEncodings( Print );
+        for( const auto& check : { VerifyTargetOffsetsOnStandIns( Print ), VerifyPatternHeaderOnStandIns( Print ), VerifyShortestSignatures( Print ) } ) {
+            result.patterns += check.patterns;
+            result.mismatches += check.mismatches;
+        }
+        const auto standInResult = VerifyScanEnginesOnStandIns( options );
+        result.patterns += standInResult.patterns;
+        result.mismatches += standInResult.mismatches;
+        for( const auto& image : images ) {
+            const auto imageResult = VerifyScanEngines( *image, image->GetName( ), options );
+            result.patterns += imageResult.patterns;
+            result.mismatches += imageResult.mismatches;
+        }
+        Print( std::string( result.mismatches == 0 ? "PASSED" : "FAILED" ) + ": " + std::to_string( result.mismatches ) + " mismatches for " +
+               std::to_string( result.patterns ) + " patterns\n" );
+        return result.mismatches == 0 ? 0 : 1;
+    }
+
+    BenchmarkOptions options;
+    options.engines = engines;
+    options.print = Print;
+    for( const auto& image : images ) {
+        const auto addresses = image->GetInstructionAddresses( std::numeric_limits<size_t>::max( ) );
+        RunBenchmark( *image, image->GetName( ), addresses, options );
+    }
+    constexpr size_t syntheticImageSizes[] = { 1 << 20, 16 << 20, 64 << 20 };
+    RunSyntheticBenchmarks( syntheticImageSizes, options );
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include "Database.h"
+#include <algorithm>
+#include <future>
+
+// Segment copy under construction
+struct Database::WarmUpState {
+    SegmentBuffer buffer;
+    size_t blockIndex = 0;
+    size_t blockOffset = 0;
+    std::atomic<bool> cancelled = false;
+    std::future<bool> histogram;
+};
+
+// Buffer sized for all segments, with address-contiguous segments sharing a block so matches may span them like they do in the database
+static SegmentBuffer LayoutSegments( const std::vector<SegmentRange>& segments, const MemoryPlacement& placement ) {
+    SegmentBuffer buffer;
+    size_t totalSize = 0;
+    for( const auto& segment : segments ) {
+        const size_t size = segment.endEA - segment.startEA;
+        if( size == 0 ) {
+            continue;
+        }
+
+        if( !buffer.blocks.empty( ) && buffer.blocks.back( ).startEA + buffer.blocks.back( ).size == segment.startEA ) {
+            buffer.blocks.back( ).size += size;
+        }
+        else {
+            buffer.blocks.push_back( { segment.startEA, totalSize, size } );
+        }
+        totalSize += size;
+    }
+    buffer.data = SegmentMemory::Allocate( totalSize, placement, SCAN_CHUNK_SIZE );
+    return buffer;
+}
+
+Database::Database( ) = default;
+
+Database::~Database( ) {
+    CancelWarmUp( );
+}
+
+std::vector<uint64_t> Database::FindOccurences( const Signature& signature, size_t limit, const CancelToken* cancelToken ) const {
+    if( scanEngine == ScanEngine::Native || IsWarmingUp( ) ) {
+        return FindOccurencesNative( signature, limit, cancelToken );
+    }
+    if( scanWorkers != nullptr ) {
+        return FindSignatureOccurencesInBufferParallel( GetSegmentBuffer( ), signature, scanEngine, *scanWorkers, limit, cancelToken );
+    }
+    return FindSignatureOccurencesInBuffer( GetSegmentBuffer( ), signature, scanEngine, limit, cancelToken );
+}
+
+const SegmentBuffer& Database::GetSegmentBuffer( ) const {
+    if( segmentBuffer.Empty( ) ) {
+        if( IsWarmingUp( ) ) {
+            // Finish the copy the warm-up started instead of starting over
+            while( ContinueWarmUp( std::numeric_limits<size_t>::max( ), true ) ) {
+            }
+        }
+        else {
+            segmentBuffer = ReadSegmentsToBuffer( );
+            ComputeByteHistogram( segmentBuffer );
+        }
+    }
+    return segmentBuffer;
+}
+
+void Database::ResetSegmentBuffer( ) {
+    CancelWarmUp( );
+    segmentBuffer = {};
+}
+
+bool Database::WarmUpSegmentBuffer( size_t maxBytes ) {
+    return ContinueWarmUp( maxBytes, false );
+}
+
+bool Database::ContinueWarmUp( size_t maxBytes, bool waitForHistogram ) const {
+    if( !segmentBuffer.Empty( ) ) {
+        return false;
+    }
+    if( warmUp == nullptr ) {
+        warmUp = std::make_unique<WarmUpState>( );
+        warmUp->buffer = LayoutSegments( GetSegments( ), memoryPlacement );
+    }
+
+    auto& state = *warmUp;
+    if( state.histogram.valid( ) ) {
+        // Copy is complete, publish it once the histogram is counted
+        if( !waitForHistogram && state.histogram.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready ) {
+            return true;
+        }
+        state.histogram.get( );
+        segmentBuffer = std::move( state.buffer );
+        warmUp.reset( );
+        return false;
+    }
+
+    // Copy the next piece, ReadBytes may only be safe on the calling thread
+    size_t copied = 0;
+    while( copied < maxBytes && state.blockIndex < state.buffer.blocks.size( ) ) {
+        const auto& block = state.buffer.blocks[state.blockIndex];
+        const auto size = std::min( maxBytes - copied, block.size - state.blockOffset );
+        ReadBytes( block.startEA + state.blockOffset, &state.buffer.data[block.offset + state.blockOffset], size );
+        copied += size;
+        state.blockOffset += size;
+        if( state.blockOffset == block.size ) {
+            state.blockIndex++;
+            state.blockOffset = 0;
+        }
+    }
+
+    if( state.blockIndex == state.buffer.blocks.size( ) ) {
+        state.histogram = std::async( std::launch::async, [&state]( ) {
+            return ComputeByteHistogram( state.buffer, &state.cancelled );
+        } );
+    }
+    return true;
+}
+
+void Database::CancelWarmUp( ) const {
+    if( warmUp == nullptr ) {
+        return;
+    }
+    warmUp->cancelled = true;
+    if( warmUp->histogram.valid( ) ) {
+        warmUp->histogram.wait( );
+    }
+    warmUp.reset( );
+}
+
+std::vector<uint64_t> Database::FindOccurencesNative( const Signature& signature, size_t limit, const CancelToken* cancelToken ) const {
+    return FindSignatureOccurencesInBuffer( GetSegmentBuffer( ), signature, ScanEngine::Reference, limit, cancelToken );
+}
+
+SegmentBuffer Database::ReadSegmentsToBuffer( ) const {
+    auto buffer = LayoutSegments( GetSegments( ), memoryPlacement );
+    for( const auto& block : buffer.blocks ) {
+        ReadBytes( block.startEA, &buffer.data[block.offset], block.size );
+    }
+    return buffer;
+}
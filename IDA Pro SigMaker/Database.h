@@ -0,0 +1,84 @@
+#pragma once
+#include "SearchCore.h"
+#include <memory>
+
+// Address range of a segment
+struct SegmentRange {
+    uint64_t startEA;
+    uint64_t endEA;
+};
+
+// Decoded instruction, reduced to what signature generation needs
+struct DecodedInstruction {
+    size_t length = 0;
+    // Byte range of the operand that should be wildcarded, operandLength is 0 if there is none
+    uint8_t operandOffset = 0;
+    uint8_t operandLength = 0;
+    // Bits of each byte that have to match, for decoders that know where register fields are
+    bool hasMatchMasks = false;
+    uint8_t matchMasks[16] = {};
+};
+
+// Minimal view of the analysed image: byte source, instruction decoder and segment list
+// This keeps the generation and search core free of IDA, so it can run against stand-in images as well
+class Database {
+public:
+    Database( );
+    virtual ~Database( );
+
+    // Segment list
+    virtual std::vector<SegmentRange> GetSegments( ) const = 0;
+
+    // Byte source, returns the amount of bytes read
+    virtual size_t ReadBytes( uint64_t ea, uint8_t* buffer, size_t size ) const = 0;
+
+    // Instruction decoder
+    virtual bool IsCode( uint64_t ea ) const = 0;
+    // Returns false if there is no valid instruction at the address
+    // Only operands whose type is set in operandTypeBitmask are reported for wildcarding, match masks only for granularities finer than bytes
+    virtual bool DecodeInstruction( uint64_t ea, uint32_t operandTypeBitmask, WildcardGranularity granularity, DecodedInstruction& instruction ) const = 0;
+    // Start of the function containing the address, or BAD_ADDRESS
+    virtual uint64_t GetFunctionStart( uint64_t ea ) const = 0;
+    // Start of the instruction ending right before the address, or BAD_ADDRESS
+    virtual uint64_t GetPreviousInstruction( uint64_t ea ) const = 0;
+
+    // Find occurences of the signature in ascending address order, stops after `limit` matches or once cancelToken is cancelled
+    // While the segment copy is still warming up, this uses the native search instead of waiting for it
+    std::vector<uint64_t> FindOccurences( const Signature& signature, size_t limit = std::numeric_limits<size_t>::max( ), const CancelToken* cancelToken = nullptr ) const;
+
+    // Copy of all segments, created on first use. Finishes a running warm-up and waits for it, so check IsWarmingUp to avoid blocking
+    const SegmentBuffer& GetSegmentBuffer( ) const;
+    void ResetSegmentBuffer( );
+    bool IsSegmentBufferReady( ) const {
+        return !segmentBuffer.Empty( );
+    }
+
+    // Build the segment copy and its byte histogram ahead of the first search, in steps that can be spread over idle time
+    // Each call copies up to maxBytes, the histogram is counted on a background thread. Returns false once the copy is ready
+    bool WarmUpSegmentBuffer( size_t maxBytes );
+    bool IsWarmingUp( ) const {
+        return warmUp != nullptr;
+    }
+    void CancelWarmUp( ) const;
+
+    // Engine used by FindOccurences
+    ScanEngine scanEngine = ScanEngine::Native;
+    // Page size and NUMA placement of the segment copy, takes effect when the copy is created next
+    MemoryPlacement memoryPlacement;
+    // Workers that scan the segment copy in parallel, not owned. Scans run on the calling thread if not set
+    NodeWorkers* scanWorkers = nullptr;
+    // Wildcard the whole instruction when the operand is encoded into the operator
+    bool wildcardOptimizedInstruction = true;
+
+protected:
+    // Search using the database's own facilities, defaults to the reference scanner
+    virtual std::vector<uint64_t> FindOccurencesNative( const Signature& signature, size_t limit, const CancelToken* cancelToken ) const;
+    virtual SegmentBuffer ReadSegmentsToBuffer( ) const;
+
+private:
+    struct WarmUpState;
+    bool ContinueWarmUp( size_t maxBytes, bool waitForHistogram ) const;
+
+    mutable SegmentBuffer segmentBuffer;
+    mutable std::unique_ptr<WarmUpState> warmUp;
+};
@@ -0,0 +1,201 @@
+#include "ExternalImages.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <future>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static std::string ExternalImagePathList;
+static std::vector<std::unique_ptr<MappedImage>> ExternalImages;
+
+MappedImage::~MappedImage( ) {
+    Close( );
+}
+
+bool MappedImage::Open( const std::string& filePath ) {
+    Close( );
+#ifdef _WIN32
+    fileHandle = CreateFileA( filePath.c_str( ), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+    if( fileHandle == INVALID_HANDLE_VALUE ) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize{};
+    if( !GetFileSizeEx( fileHandle, &fileSize ) || fileSize.QuadPart == 0 ) {
+        Close( );
+        return false;
+    }
+
+    mappingHandle = CreateFileMappingA( fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    if( mappingHandle == nullptr ) {
+        Close( );
+        return false;
+    }
+
+    data = reinterpret_cast<const uint8_t*>( MapViewOfFile( mappingHandle, FILE_MAP_READ, 0, 0, 0 ) );
+    if( data == nullptr ) {
+        Close( );
+        return false;
+    }
+    size = static_cast<size_t>( fileSize.QuadPart );
+#else
+    auto fd = open( filePath.c_str( ), O_RDONLY );
+    if( fd < 0 ) {
+        return false;
+    }
+
+    struct stat fileStat {};
+    if( fstat( fd, &fileStat ) != 0 || fileStat.st_size == 0 ) {
+        close( fd );
+        return false;
+    }
+
+    auto mapping = mmap( nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if( mapping == MAP_FAILED ) {
+        return false;
+    }
+    data = reinterpret_cast<const uint8_t*>( mapping );
+    size = static_cast<size_t>( fileStat.st_size );
+#endif
+    path = filePath;
+    return true;
+}
+
+void MappedImage::Close( ) {
+#ifdef _WIN32
+    if( data != nullptr ) {
+        UnmapViewOfFile( data );
+    }
+    if( mappingHandle != nullptr ) {
+        CloseHandle( mappingHandle );
+        mappingHandle = nullptr;
+    }
+    if( fileHandle != INVALID_HANDLE_VALUE ) {
+        CloseHandle( fileHandle );
+        fileHandle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if( data != nullptr ) {
+        munmap( const_cast<uint8_t*>( data ), size );
+    }
+#endif
+    data = nullptr;
+    size = 0;
+    path.clear( );
+}
+
+std::vector<std::string> LoadExternalImages( std::string_view pathList ) {
+    UnloadExternalImages( );
+    ExternalImagePathList = pathList;
+
+    std::vector<std::string> failedPaths;
+    size_t start = 0;
+    while( start <= pathList.size( ) ) {
+        auto end = pathList.find( ';', start );
+        if( end == std::string_view::npos ) {
+            end = pathList.size( );
+        }
+
+        // Trim whitespace and quotes around each path
+        auto path = pathList.substr( start, end - start );
+        while( !path.empty( ) && ( std::isspace( static_cast<unsigned char>( path.front( ) ) ) || path.front( ) == '"' ) ) {
+            path.remove_prefix( 1 );
+        }
+        while( !path.empty( ) && ( std::isspace( static_cast<unsigned char>( path.back( ) ) ) || path.back( ) == '"' ) ) {
+            path.remove_suffix( 1 );
+        }
+
+        if( !path.empty( ) ) {
+            auto image = std::make_unique<MappedImage>( );
+            if( image->Open( std::string( path ) ) ) {
+                ExternalImages.push_back( std::move( image ) );
+            }
+            else {
+                failedPaths.emplace_back( path );
+            }
+        }
+        start = end + 1;
+    }
+    return failedPaths;
+}
+
+void UnloadExternalImages( ) {
+    ExternalImages.clear( );
+    ExternalImagePathList.clear( );
+}
+
+const std::string& GetExternalImagePathList( ) {
+    return ExternalImagePathList;
+}
+
+const std::vector<std::unique_ptr<MappedImage>>& GetExternalImages( ) {
+    return ExternalImages;
+}
+
+static bool MatchesAt( const uint8_t* data, const Signature& signature ) {
+    for( size_t i = 0; i < signature.size( ); i++ ) {
+        if( !MatchesSignatureByte( data[i], signature[i] ) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static size_t CountOccurencesInBuffer( const uint8_t* data, size_t size, const Signature& signature, size_t limit ) {
+    if( signature.empty( ) || signature.size( ) > size ) {
+        return 0;
+    }
+
+    // Anchor the scan on the first fully fixed byte, so memchr can skip ahead
+    const auto anchor = std::ranges::find_if( signature, []( const auto& sb ) { return GetMatchMask( sb ) == 0xFF; } );
+    const auto lastStart = size - signature.size( );
+    if( anchor == signature.end( ) ) {
+        // Only wildcards and partial wildcards, test every position
+        size_t count = 0;
+        for( size_t offset = 0; offset <= lastStart && count < limit; offset++ ) {
+            count += MatchesAt( data + offset, signature );
+        }
+        return count;
+    }
+    const size_t anchorIndex = anchor - signature.begin( );
+
+    size_t count = 0;
+    auto current = data + anchorIndex;
+    const auto end = data + lastStart + anchorIndex + 1;
+    while( current < end ) {
+        current = reinterpret_cast<const uint8_t*>( std::memchr( current, anchor->value, end - current ) );
+        if( current == nullptr ) {
+            break;
+        }
+
+        if( MatchesAt( current - anchorIndex, signature ) && ++count >= limit ) {
+            break;
+        }
+        ++current;
+    }
+    return count;
+}
+
+std::vector<size_t> CountSignatureOccurencesInImages( const Signature& signature, size_t limit ) {
+    std::vector<std::future<size_t>> jobs;
+    jobs.reserve( ExternalImages.size( ) );
+    for( const auto& image : ExternalImages ) {
+        jobs.push_back( std::async( std::launch::async, [&image, &signature, limit]( ) {
+            return CountOccurencesInBuffer( image->Data( ), image->Size( ), signature, limit );
+        } ) );
+    }
+
+    std::vector<size_t> counts;
+    counts.reserve( jobs.size( ) );
+    for( auto& job : jobs ) {
+        counts.push_back( job.get( ) );
+    }
+    return counts;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "Signature.h"
+#include <memory>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#endif
+
+// Read-only memory mapping of a raw binary or dump on disk
+class MappedImage {
+public:
+    MappedImage( ) = default;
+    ~MappedImage( );
+
+    MappedImage( const MappedImage& ) = delete;
+    MappedImage& operator=( const MappedImage& ) = delete;
+
+    bool Open( const std::string& filePath );
+    void Close( );
+
+    const uint8_t* Data( ) const {
+        return data;
+    }
+    size_t Size( ) const {
+        return size;
+    }
+    const std::string& Path( ) const {
+        return path;
+    }
+
+private:
+    std::string path;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mappingHandle = nullptr;
+#endif
+};
+
+// Images a signature has to be unique in, in addition to the current database
+// Returns the paths that could not be mapped
+std::vector<std::string> LoadExternalImages( std::string_view pathList );
+void UnloadExternalImages( );
+const std::string& GetExternalImagePathList( );
+const std::vector<std::unique_ptr<MappedImage>>& GetExternalImages( );
+
+// Count occurences of the signature in every loaded image concurrently, stopping at `limit` per image
+std::vector<size_t> CountSignatureOccurencesInImages( const Signature& signature, size_t limit );
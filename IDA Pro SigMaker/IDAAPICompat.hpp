@@ -28,6 +28,14 @@ inline ea_t compat_inf_get_max_ea( ) {
 #endif
 }
 
+inline bool compat_inf_is_64bit( ) {
+#if IDP_INTERFACE_VERSION >= IDA_9_VERSION // IDA 9
+	return inf_is_64bit( );
+#else // IDA 8
+	return inf.is_64bit( );
+#endif
+}
+
 inline ea_t compat_bin_search( ea_t start_ea, ea_t end_ea, const compiled_binpat_vec_t& data, int flags ) {
 #if IDP_INTERFACE_VERSION >= 900 // IDA 9
 #ifdef __SDK_BETA__ // IDA 9 Beta
@@ -0,0 +1,218 @@
+#include "Plugin.h"
+#include "IDADatabase.h"
+#include "IDAAPICompat.hpp"
+#include "SignatureUtils.h"
+#include "Utils.h"
+#include "X86Decoder.h"
+#include <algorithm>
+
+static uint64_t ToAddress( ea_t ea ) {
+    return ea == BADADDR ? BAD_ADDRESS : ea;
+}
+
+static ea_t ToEA( uint64_t address ) {
+    return address == BAD_ADDRESS ? BADADDR : static_cast<ea_t>( address );
+}
+
+static bool GetOperandOffset( const insn_t& instruction, uint8_t* operandOffset, uint8_t* operandLength, uint32_t operandTypeBitmask, uint32_t processorArch, bool wildcardOptimizedInstruction ) {
+
+    // Iterate all operands
+    for( const auto& op : instruction.ops ) {
+        // Skip if we have no operand
+        if( op.type == o_void ) {
+            continue;
+        }
+
+        // Apply operand bitmask filter
+        if( ( BIT( op.type ) & operandTypeBitmask ) == 0 ) {
+            continue;
+        }
+
+        *operandOffset = op.offb;
+
+        bool isOptimizedInstr = false;
+        // Find operand length based on processor arch
+        switch( processorArch ) {
+        case PLFM_ARM: // ARM, since operands are at the beginning
+        {
+            // This is somewhat of a hack because IDA api does not provide more info for ARM
+            // I always assume the operand is 3 bytes long with 1 byte operator
+            if( instruction.size == 4 ) {
+                *operandLength = 3;
+            }
+            // I saw some ADRL instruction having 8 bytes
+            if( instruction.size == 8 ) {
+                *operandLength = 7;
+            }
+            break;
+        }
+        case PLFM_386: // METAPC
+        {
+            // Usually the instruction is optimized and the operand is part of the operator and thus can't be described by offb
+            if( op.offb == 0 ) {
+                isOptimizedInstr = true;
+            }
+        }
+        default: // Everything else
+            *operandLength = instruction.size - op.offb;
+            break;
+        }
+
+        if( isOptimizedInstr && !wildcardOptimizedInstruction ) {
+            continue;
+        }
+
+        return true;
+    }
+    return false;
+}
+
+std::vector<SegmentRange> IDADatabase::GetSegments( ) const {
+    std::vector<SegmentRange> segments;
+    for( int i = 0; i < get_segm_qty( ); ++i ) {
+        auto seg = getnseg( i );
+        if( !seg ) {
+            continue;
+        }
+        segments.push_back( { seg->start_ea, seg->end_ea } );
+    }
+    return segments;
+}
+
+size_t IDADatabase::ReadBytes( uint64_t ea, uint8_t* buffer, size_t size ) const {
+    const auto bytesRead = get_bytes( buffer, size, ToEA( ea ) );
+    return bytesRead > 0 ? static_cast<size_t>( bytesRead ) : 0;
+}
+
+bool IDADatabase::IsCode( uint64_t ea ) const {
+    return is_code( get_flags( ToEA( ea ) ) );
+}
+
+bool IDADatabase::DecodeInstruction( uint64_t ea, uint32_t operandTypeBitmask, WildcardGranularity granularity, DecodedInstruction& instruction ) const {
+    if( useOfflineDecoder && processorArch == PLFM_386 ) {
+        // Prefer the segment copy, so decoding does not have to go through IDA at all
+        uint8_t bytes[16];
+        const auto available = IsSegmentBufferReady( ) ? ReadFromSegmentBuffer( GetSegmentBuffer( ), ea, bytes, sizeof( bytes ) ) : ReadBytes( ea, bytes, sizeof( bytes ) );
+
+        X86Instruction x86Instruction;
+        if( !DecodeX86Instruction( bytes, available, is64Bit, x86Instruction ) ) {
+            return false;
+        }
+
+        instruction = {};
+        instruction.length = x86Instruction.length;
+
+        uint8_t operandOffset = 0, operandLength = 0;
+        if( operandTypeBitmask != 0 && GetX86OperandWildcard( x86Instruction, operandTypeBitmask, wildcardOptimizedInstruction, operandOffset, operandLength ) && operandLength > 0 ) {
+            instruction.operandOffset = operandOffset;
+            instruction.operandLength = operandLength;
+        }
+        if( granularity != WildcardGranularity::Byte ) {
+            GetX86OperandMatchMasks( x86Instruction, operandTypeBitmask, instruction.matchMasks );
+            instruction.hasMatchMasks = true;
+        }
+        return true;
+    }
+
+    insn_t insn;
+    const auto length = decode_insn( &insn, ToEA( ea ) );
+    if( length <= 0 ) {
+        return false;
+    }
+
+    instruction = {};
+    instruction.length = static_cast<size_t>( length );
+
+    uint8_t operandOffset = 0, operandLength = 0;
+    if( operandTypeBitmask != 0 && GetOperandOffset( insn, &operandOffset, &operandLength, operandTypeBitmask, processorArch, wildcardOptimizedInstruction ) && operandLength > 0 ) {
+        instruction.operandOffset = operandOffset;
+        instruction.operandLength = operandLength;
+    }
+
+    // IDA does not expose register fields, take them from the built-in decoder if it agrees on the instruction
+    if( processorArch == PLFM_386 && granularity != WildcardGranularity::Byte ) {
+        uint8_t bytes[16];
+        const auto available = ReadBytes( ea, bytes, std::min( instruction.length, sizeof( bytes ) ) );
+        X86Instruction x86Instruction;
+        if( DecodeX86Instruction( bytes, available, is64Bit, x86Instruction ) && x86Instruction.length == instruction.length ) {
+            GetX86OperandMatchMasks( x86Instruction, operandTypeBitmask, instruction.matchMasks );
+            instruction.hasMatchMasks = true;
+        }
+    }
+    return true;
+}
+
+uint64_t IDADatabase::GetFunctionStart( uint64_t ea ) const {
+    const auto function = get_func( ToEA( ea ) );
+    return function ? ToAddress( function->start_ea ) : BAD_ADDRESS;
+}
+
+uint64_t IDADatabase::GetPreviousInstruction( uint64_t ea ) const {
+    const auto previous = prev_head( ToEA( ea ), compat_inf_get_min_ea( ) );
+    if( previous == BADADDR || !is_code( get_flags( previous ) ) || get_item_end( previous ) != ToEA( ea ) ) {
+        return BAD_ADDRESS;
+    }
+    return ToAddress( previous );
+}
+
+std::vector<uint64_t> IDADatabase::FindOccurencesNative( const Signature& signature, size_t limit, const CancelToken* cancelToken ) const {
+    // bin_search has no partial wildcards, search with those bytes wildcarded and verify the hits afterwards
+    auto searchSignature = signature;
+    ApplyWildcardGranularity( searchSignature, WildcardGranularity::Byte );
+    const auto hasPartialWildcard = std::ranges::any_of( signature, IsPartialWildcard );
+    std::vector<uint8_t> bytes( signature.size( ) );
+
+    // Convert signature string to searchable struct
+    compiled_binpat_vec_t binaryPattern;
+    parse_binpat_str( &binaryPattern, compat_inf_get_min_ea( ), BuildIDASignatureString( searchSignature ).c_str( ), 16 );
+
+    // Search for occurences, address-contiguous segments as one range so matches may span them
+    std::vector<uint64_t> results;
+    const auto segments = GetSegments( );
+    for( size_t i = 0; i < segments.size( ) && results.size( ) < limit; ) {
+        const auto rangeStart = segments[i].startEA;
+        auto rangeEnd = segments[i].endEA;
+        for( i++; i < segments.size( ) && segments[i].startEA == rangeEnd; i++ ) {
+            rangeEnd = segments[i].endEA;
+        }
+
+        // One bin_search over a huge range can't be interrupted, so search chunk by chunk
+        for( auto chunkStart = rangeStart; chunkStart < rangeEnd && results.size( ) < limit; chunkStart += SCAN_CHUNK_SIZE ) {
+            if( cancelToken != nullptr && cancelToken->IsCancelled( ) ) {
+                return results;
+            }
+
+            // Matches starting in the chunk may end behind it
+            const auto chunkEnd = std::min<uint64_t>( chunkStart + SCAN_CHUNK_SIZE, rangeEnd );
+            const auto searchEnd = std::min<uint64_t>( chunkEnd + signature.size( ) - 1, rangeEnd );
+            auto ea = chunkStart;
+            while( results.size( ) < limit ) {
+                auto occurence = compat_bin_search( ToEA( ea ), ToEA( searchEnd ), binaryPattern, BIN_SEARCH_NOCASE | BIN_SEARCH_FORWARD );
+
+                // Signature not found anymore in this chunk, a match behind it belongs to the next one
+                if( occurence == BADADDR || occurence >= chunkEnd ) {
+                    break;
+                }
+
+                ea = occurence + 1;
+
+                if( hasPartialWildcard ) {
+                    ReadBytes( occurence, bytes.data( ), bytes.size( ) );
+                    if( !std::ranges::equal( bytes, signature, MatchesSignatureByte ) ) {
+                        continue;
+                    }
+                }
+                results.push_back( occurence );
+            }
+        }
+    }
+    return results;
+}
+
+SegmentBuffer IDADatabase::ReadSegmentsToBuffer( ) const {
+    // Load segments into our own buffer, since we can't get a direct pointer to the mapped binary
+    show_wait_box( "Please stand by, copying segments..." );
+    auto buffer = Database::ReadSegmentsToBuffer( );
+    hide_wait_box( );
+    return buffer;
+}
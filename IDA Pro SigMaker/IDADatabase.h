@@ -0,0 +1,23 @@
+#pragma once
+#include "Database.h"
+
+// Database backed by the currently opened IDB
+class IDADatabase final : public Database {
+public:
+    std::vector<SegmentRange> GetSegments( ) const override;
+    size_t ReadBytes( uint64_t ea, uint8_t* buffer, size_t size ) const override;
+    bool IsCode( uint64_t ea ) const override;
+    bool DecodeInstruction( uint64_t ea, uint32_t operandTypeBitmask, WildcardGranularity granularity, DecodedInstruction& instruction ) const override;
+    uint64_t GetFunctionStart( uint64_t ea ) const override;
+    uint64_t GetPreviousInstruction( uint64_t ea ) const override;
+
+    // Set from the processor module
+    uint32_t processorArch = 0;
+    bool is64Bit = false;
+    // Decode x86 and x64 with the built-in decoder instead of decode_insn
+    bool useOfflineDecoder = false;
+
+protected:
+    std::vector<uint64_t> FindOccurencesNative( const Signature& signature, size_t limit, const CancelToken* cancelToken ) const override;
+    SegmentBuffer ReadSegmentsToBuffer( ) const override;
+};
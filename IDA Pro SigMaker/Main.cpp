@@ -2,410 +2,125 @@
 #include "Utils.h"
 #include "SignatureUtils.h"
 #include "IDAAPICompat.hpp"
-
-#define QIS_SIGNATURE_USE_AVX2 1 
-#include <qis/signature.hpp>
+#include "ExternalImages.h"
+#include "IDADatabase.h"
+#include "SignatureGenerator.h"
+#include "Benchmark.h"
+#include "Verification.h"
+#include "SignatureStore.h"
+#include "BatchGeneration.h"
+#include "SearchResultsChooser.h"
 
 uint32_t PROCESSOR_ARCH;
 
 bool USE_QIS_SIGNATURE = false;
 bool WILDCARD_OPTIMIZED_INSTRUCTION = true;
+bool USE_OFFLINE_DECODER = false;
+bool PARTIAL_WILDCARDS = false;
+bool GROW_BACKWARDS = false;
 size_t PRINT_TOP_X = 5;
 size_t MAX_SINGLE_SIGNATURE_LENGTH = 1000;
 size_t MAX_XREF_SIGNATURE_LENGTH = 250;
+size_t SIGNATURE_TIME_BUDGET_MS = 0;
+size_t XREF_DEADLINE_SECONDS = 0;
+size_t MAX_SEARCH_RESULTS = 100000;
 
-std::vector<uint8_t> FILE_BUFFER = {};
+IDADatabase DATABASE;
+SignatureStore SIGNATURE_STORE( DATABASE );
+SearchResultsChooser SEARCH_RESULTS( DATABASE );
 
 static uint32_t WildcardableOperandTypeBitmask = 0;
-
-static bool GetOperandOffset( const insn_t& instruction, uint8_t* operandOffset, uint8_t* operandLength, uint32_t operandTypeBitmask ) {
-
-	// Iterate all operands
-	for( const auto& op : instruction.ops ) {
-		// Skip if we have no operand
-		if( op.type == o_void ) {
-			continue;
-		}
-
-		// Apply operand bitmask filter
-		if( ( BIT( op.type ) & operandTypeBitmask ) == 0 ) {
-			continue;
-		}
-
-		*operandOffset = op.offb;
-
-		bool isOptimizedInstr = false;
-		// Find operand length based on processor arch
-		switch( PROCESSOR_ARCH ) {
-		case PLFM_ARM: // ARM, since operands are at the beginning
-		{
-			// This is somewhat of a hack because IDA api does not provide more info for ARM
-			// I always assume the operand is 3 bytes long with 1 byte operator
-			if( instruction.size == 4 ) {
-				*operandLength = 3;
-			}
-			// I saw some ADRL instruction having 8 bytes
-			if( instruction.size == 8 ) {
-				*operandLength = 7;
-			}
-			break;
-		}
-		case PLFM_386: // METAPC
-		{
-			// Usually the instruction is optimized and the operand is part of the operator and thus can't be described by offb
-			if( op.offb == 0 ) {
-				isOptimizedInstr = true;
-			}
-		}
-		default: // Everything else
-			*operandLength = instruction.size - op.offb;
-			break;
-		}
-
-		if( isOptimizedInstr && !WILDCARD_OPTIMIZED_INSTRUCTION ) {
-	 		continue;
-		}
-
-		return true;
-	}
-	return false;
-}
-
-// Credit: belmeopmenieuwesim @ https://github.com/belmeopmenieuwesim/IDA-Pro-SigMaker/blob/697bebd3ecd71cb8af21ab10fb5006af8676252f/IDA%20Pro%20SigMaker/Main.cpp#L204C1-L227C52
-static std::vector<uint8_t> ReadSegmentsToBuffer( ) {
-	std::vector<uint8_t> buffer;
-
-	// Iterate over all segments
-	for( int i = 0; i < get_segm_qty( ); ++i ) {
-		auto seg = getnseg( i );
-		if( !seg ) {
-			continue;
-		}
-
-		auto ea = buffer.empty( ) ? compat_inf_get_min_ea( ) : seg->start_ea;
-		size_t size = seg->end_ea - ea;
-
-		// Resize the buffer to accommodate the segment data
-		auto current_size = buffer.size( );
-		buffer.resize( current_size + size );
-
-		// Read the segment data into the buffer
-		get_bytes( &buffer[current_size], size, ea );
-	}
-
-	return buffer;
-}
-//
-
-static std::string IdaToQisSignatureStr( std::string_view idaSignature ) {
-	// Qis signature uses double quotes
-	return std::regex_replace( idaSignature.data( ), std::regex( "\\?" ), "??" );
-}
-
-static std::vector<ea_t> FindSignatureOccurencesQis( std::string_view idaSignature, bool skipMoreThanOne = false ) {
-
-	// Load file into our own buffer, since we can't get a direct pointer to the mapped binary
-	if( FILE_BUFFER.empty( ) ) {
-		show_wait_box( "Please stand by, copying segments..." );
-		FILE_BUFFER = ReadSegmentsToBuffer( );
-		hide_wait_box( );
-	}
-
-	// Create qis signature from ida signature string
-	const qis::signature qisSignature( IdaToQisSignatureStr( idaSignature ) );
-
-	// Search for occurences
-	std::vector<ea_t> results;
-	auto currentPtr = FILE_BUFFER.data( );
-	while( true ) {
-		auto occurence = qis::scan( currentPtr, FILE_BUFFER.size( ) - ( currentPtr - FILE_BUFFER.data( ) ), qisSignature );
-
-		// Signature not found anymore
-		if( occurence == qis::npos ) {
-			break;
-		}
-
-		//  In case we only care about uniqueness, return after more than one result
-		if( skipMoreThanOne && results.size( ) > 1 ) {
-			break;
-		}
-
-		auto fileOffset = ( ( currentPtr - FILE_BUFFER.data( ) ) + occurence );
-
-		results.push_back( compat_inf_get_min_ea( ) + fileOffset );
-
-		currentPtr = FILE_BUFFER.data( ) + fileOffset + 1;
-	}
-	return results;
-}
-
-static std::vector<ea_t> FindSignatureOccurences( std::string_view idaSignature, bool skipMoreThanOne = false ) {
-
-	if( USE_QIS_SIGNATURE ) {
-		return FindSignatureOccurencesQis( idaSignature, skipMoreThanOne );
-	}
-
-	// Convert signature string to searchable struct
-	compiled_binpat_vec_t binaryPattern;
-	parse_binpat_str( &binaryPattern, compat_inf_get_min_ea( ), idaSignature.data( ), 16 );
-
-	// Search for occurences
-	std::vector<ea_t> results;
-	auto ea = compat_inf_get_min_ea( );
-	while( true ) {
-		auto occurence = compat_bin_search( ea, compat_inf_get_max_ea( ), binaryPattern, BIN_SEARCH_NOCASE | BIN_SEARCH_FORWARD );
-
-		// Signature not found anymore
-		if( occurence == BADADDR ) {
-			break;
-		}
-
-		//  In case we only care about uniqueness, return after more than one result
-		if( skipMoreThanOne && results.size( ) > 1 ) {
-			break;
-		}
-
-		results.push_back( occurence );
-
-		ea = occurence + 1;
-	}
-	return results;
+static WildcardGranularity OutputWildcardGranularity = WildcardGranularity::Byte;
+static qtimer_t RecheckTimer = nullptr;
+static qtimer_t WarmUpTimer = nullptr;
+static std::unique_ptr<NodeWorkers> ScanWorkers;
+
+static GeneratorOptions MakeGeneratorOptions( bool wildcardOperands, bool continueOutsideOfFunction, uint32_t operandTypeBitmask, size_t maxSignatureLength, bool askLongerSignature = true ) {
+	GeneratorOptions options;
+	options.wildcardOperands = wildcardOperands;
+	options.continueOutsideOfFunction = continueOutsideOfFunction;
+	options.operandTypeBitmask = operandTypeBitmask;
+	options.maxSignatureLength = maxSignatureLength;
+	options.wildcardGranularity = OutputWildcardGranularity;
+	options.timeBudgetMs = SIGNATURE_TIME_BUDGET_MS;
+	if( askLongerSignature ) {
+		options.askLongerSignature = []( size_t signatureLength ) {
+			return ask_yn( ASKBTN_YES, "Signature is already at %llu bytes. Continue?", signatureLength );
+		};
+	}
+	options.isCancelled = []( ) {
+		return user_cancelled( );
+	};
+	options.log = []( std::string_view message ) {
+		msg( "%s", std::string( message ).c_str( ) );
+	};
+	return options;
 }
 
-static bool IsSignatureUnique( std::string_view idaSignature ) {
-	return FindSignatureOccurences( idaSignature, true ).size( ) == 1;
-}
-
-static std::expected<Signature, std::string> GenerateUniqueSignatureForEA( ea_t ea, bool wildcardOperands, bool continueOutsideOfFunction, uint32_t operandTypeBitmask, size_t maxSignatureLength, bool askLongerSignature = true ) {
-	if( ea == BADADDR ) {
-		return std::unexpected( "Invalid address" );
-	}
-
-	if( !is_code( get_flags( ea ) ) ) {
-		return std::unexpected( "Can not create code signature for data" );
-	}
-
-	Signature signature;
-	size_t sigPartLength = 0;
-
-	auto currentFunction = get_func( ea );
-
-	auto currentAddress = ea;
-	while( true ) {
-		// Handle IDA "cancel" event
-		if( user_cancelled( ) ) {
-			return std::unexpected( "Aborted" );
-		}
-
-		insn_t instruction;
-		auto currentInstructionLength = decode_insn( &instruction, currentAddress );
-		if( currentInstructionLength <= 0 ) {
-			if( signature.empty( ) ) {
-				return std::unexpected( "Failed to decode first instruction" );
-			}
-
-			msg( "Signature reached end of executable code @ %I64X\n", currentAddress );
-			auto signatureString = BuildIDASignatureString( signature );
-			msg( "NOT UNIQUE Signature for %I64X: %s\n", ea, signatureString.c_str( ) );
-			return std::unexpected( "Signature not unique" );
-		}
-
-		// Length check in case the signature becomes too long
-		if( sigPartLength > maxSignatureLength ) {
-			if( askLongerSignature ) {
-				auto result = ask_yn( ASKBTN_YES, "Signature is already at %llu bytes. Continue?", signature.size( ) );
-				if( result == 1 ) { // Yes 
-					sigPartLength = 0;
-				}
-				else if( result == 0 ) { // No
-					// Print the signature we have so far, even though its not unique
-					auto signatureString = BuildIDASignatureString( signature );
-					msg( "NOT UNIQUE Signature for %I64X: %s\n", ea, signatureString.c_str( ) );
-					return std::unexpected( "Signature not unique" );
-				}
-				else { // Cancel
-					return std::unexpected( "Aborted" );
-				}
-			}
-			else {
-				return std::unexpected( "Signature exceeded maximum length" );
-			}
-		}
-		sigPartLength += currentInstructionLength;
-
-		// Check current instruction, add its bytes to the signature accordingly
-		uint8_t operandOffset = 0, operandLength = 0;
-		if( wildcardOperands && GetOperandOffset( instruction, &operandOffset, &operandLength, operandTypeBitmask ) && operandLength > 0 ) {
-			// Add opcodes
-			AddBytesToSignature( signature, currentAddress, operandOffset, false );
-			// Wildcards for operands
-			AddBytesToSignature( signature, currentAddress + operandOffset, operandLength, true );
-			// If the operand is on the "left side", add the operator from the "right side"
-			if( operandOffset == 0 ) {
-				AddBytesToSignature( signature, currentAddress + operandLength, currentInstructionLength - operandLength, false );
-			}
-		}
-		else {
-			// No operand, add all bytes
-			AddBytesToSignature( signature, currentAddress, currentInstructionLength, false );
-		}
-
-		auto currentSig = BuildIDASignatureString( signature );
-		if( IsSignatureUnique( currentSig ) ) {
-			// Remove wildcards at end for output
-			TrimSignature( signature );
-
-			// Return the signature we generated
-			return signature;
-		}
-		currentAddress += currentInstructionLength;
-
-		// Break if we leave function
-		if( !continueOutsideOfFunction && currentFunction && get_func( currentAddress ) != currentFunction ) {
-			return std::unexpected( "Signature left function scope" );
-		}
-
-	}
-	return std::unexpected( "Unknown" );
-}
-
-// Function for code selection
-static std::expected<Signature, std::string> GenerateSignatureForEARange( ea_t eaStart, ea_t eaEnd, bool wildcardOperands, uint32_t operandTypeBitmask ) {
-	if( eaStart == BADADDR || eaEnd == BADADDR ) {
-		return std::unexpected( "Invalid address" );
-	}
-
-	Signature signature;
-	size_t sigPartLength = 0;
-
-	// Copy data section, no wildcards
-	if( !is_code( get_flags( eaStart ) ) ) {
-		AddBytesToSignature( signature, eaStart, eaEnd - eaStart, false );
-		return signature;
-	}
-
-	auto currentAddress = eaStart;
-	while( true ) {
-		// Handle IDA "cancel" event
-		if( user_cancelled( ) ) {
-			return std::unexpected( "Aborted" );
-		}
-
-		insn_t instruction;
-		auto currentInstructionLength = decode_insn( &instruction, currentAddress );
-		if( currentInstructionLength <= 0 ) {
-			if( signature.empty( ) ) {
-				return std::unexpected( "Failed to decode first instruction" );
-			}
-
-			msg( "Signature reached end of executable code @ %I64X\n", currentAddress );
-			// If we have some bytes left, add them
-			if( currentAddress < eaEnd ) {
-				AddBytesToSignature( signature, currentAddress, eaEnd - currentAddress, false );
-			}
-			TrimSignature( signature );
-			return signature;
-		}
-
-		sigPartLength += currentInstructionLength;
-
-		uint8_t operandOffset = 0, operandLength = 0;
-		if( wildcardOperands && GetOperandOffset( instruction, &operandOffset, &operandLength, operandTypeBitmask ) && operandLength > 0 ) {
-			// Add opcodes
-			AddBytesToSignature( signature, currentAddress, operandOffset, false );
-			// Wildcards for operands
-			AddBytesToSignature( signature, currentAddress + operandOffset, operandLength, true );
-			// If the operand is on the "left side", add the operator from the "right side"
-			if( operandOffset == 0 ) {
-				AddBytesToSignature( signature, currentAddress + operandLength, currentInstructionLength - operandLength, false );
-			}
-		}
-		else {
-			// No operand, add all bytes
-			AddBytesToSignature( signature, currentAddress, currentInstructionLength, false );
-		}
-		currentAddress += currentInstructionLength;
-
-		if( currentAddress >= eaEnd ) {
-
-			TrimSignature( signature );
-			return signature;
-		}
-	}
-	return std::unexpected( "Unknown" );
-}
-
-static void PrintSignatureForEA( const std::expected<Signature, std::string>& signature, ea_t ea, SignatureType sigOutputType ) {
+static void PrintSignatureForEA( const std::expected<TargetSignature, std::string>& signature, ea_t ea, SignatureType sigOutputType ) {
 	if( !signature.has_value( ) ) {
 		msg( "Error: %s\n", signature.error( ).c_str( ) );
 		return;
 	}
-	const auto signatureStr = FormatSignature( signature.value( ), sigOutputType );
-	msg( "Signature for %I64X: %s\n", ea, signatureStr.c_str( ) );
+	const auto signatureStr = FormatSignature( signature->signature, sigOutputType, signature->targetOffset );
+	if( signature->targetOffset != 0 ) {
+		msg( "Signature for %I64X (at offset %llu): %s\n", ea, signature->targetOffset, signatureStr.c_str( ) );
+	}
+	else {
+		msg( "Signature for %I64X: %s\n", ea, signatureStr.c_str( ) );
+	}
 	if( !SetClipboardText( signatureStr ) ) {
 		msg( "Failed to copy to clipboard!" );
 	}
 }
 
-static void FindXRefs( ea_t ea, bool wildcardOperands, bool continueOutsideOfFunction, std::vector<std::tuple<ea_t, Signature>>& xrefSignatures, size_t maxSignatureLength, uint32_t operandTypeBitmask ) {
+static void FindXRefs( ea_t ea, bool wildcardOperands, bool continueOutsideOfFunction, ShortestSignatures& xrefSignatures, size_t maxSignatureLength, uint32_t operandTypeBitmask ) {
 	xrefblk_t xref{};
 
-	// Count code xrefs
-	size_t xrefCount = 0;
+	// Collect code xrefs, xref.iscode is not what we want though
+	std::vector<uint64_t> xrefOrigins;
 	for( auto xref_ok = xref.first_to( ea, XREF_FAR ); xref_ok; xref_ok = xref.next_to( ) ) {
 		if( !is_code( get_flags( xref.from ) ) ) {
 			continue;
 		}
-		++xrefCount;
+		xrefOrigins.push_back( xref.from );
 	}
 
-	size_t shortestSignatureLength = maxSignatureLength + 1;
+	auto generatorOptions = MakeGeneratorOptions( wildcardOperands, continueOutsideOfFunction, operandTypeBitmask, maxSignatureLength, false );
+	generatorOptions.progress = []( size_t finished, size_t total ) {
+		replace_wait_box( "Processing xrefs, %llu of %llu done (%0.1f%%)...", finished, total, ( static_cast<float>( finished ) / total ) * 100.0f );
+	};
 
-	size_t i = 0;
-	for( auto xref_ok = xref.first_to( ea, XREF_FAR ); xref_ok; xref_ok = xref.next_to( ), ++i ) {
-
-		// Instantly abort
-		if( user_cancelled( ) ) {
-			break;
-		}
-
-		// Skip data refs, xref.iscode is not what we want though
-		if( !is_code( get_flags( xref.from ) ) ) {
-			continue;
-		}
-
-		replace_wait_box( "Processing xref %llu of %llu (%0.1f%%)...\n\nSuitable Signatures: %llu\nShortest Signature: %llu Bytes", i + 1, xrefCount, ( static_cast<float>( i ) / xrefCount ) * 100.0f, xrefSignatures.size( ), ( shortestSignatureLength <= maxSignatureLength ? shortestSignatureLength : 0 ) );
-
-		// Genreate signature for xref
-		auto signature = GenerateUniqueSignatureForEA( xref.from, wildcardOperands, continueOutsideOfFunction, operandTypeBitmask, maxSignatureLength, false );
-		if( !signature.has_value( ) ) {
-			continue;
-		}
+	// Deadline for all xrefs together, the shortest signatures found until then are printed
+	CancelToken jobToken;
+	if( XREF_DEADLINE_SECONDS > 0 ) {
+		jobToken.SetBudget( std::chrono::seconds( XREF_DEADLINE_SECONDS ) );
+	}
+	generatorOptions.jobToken = &jobToken;
 
-		// Update for statistics
-		if( signature.value( ).size( ) < shortestSignatureLength ) {
-			shortestSignatureLength = signature.value( ).size( );
+	// Xrefs in copy-pasted or inlined code start alike, they share the searches for their common prefix
+	// Each signature is offered as soon as it is done, only the shortest ones are kept
+	GenerateUniqueSignaturesForEAs( DATABASE, xrefOrigins, generatorOptions, [&]( size_t index, const std::expected<Signature, std::string>& signature ) {
+		if( signature.has_value( ) ) {
+			xrefSignatures.Offer( xrefOrigins[index], *signature );
 		}
-
-		xrefSignatures.push_back( std::make_pair( xref.from, signature.value( ) ) );
+	} );
+	if( jobToken.IsPastDeadline( ) ) {
+		msg( "Xref deadline reached, signatures that were not done yet are skipped\n" );
 	}
-
-	// Sort signatures by length
-	std::ranges::sort( xrefSignatures, []( const auto& a, const auto& b ) -> bool { return std::get<1>( a ).size( ) < std::get<1>( b ).size( ); } );
 }
 
-static void PrintXRefSignaturesForEA( ea_t ea, const std::vector<std::tuple<ea_t, Signature>>& xrefSignatures, SignatureType sigType, size_t topCount ) {
-	if( xrefSignatures.empty( ) ) {
+static void PrintXRefSignaturesForEA( ea_t ea, const ShortestSignatures& xrefSignatures, SignatureType sigType ) {
+	if( xrefSignatures.OfferedCount( ) == 0 ) {
 		msg( "No XREFs have been found for your address\n" );
 		return;
 	}
 
-	auto topLength = std::min( topCount, xrefSignatures.size( ) );
-	msg( "Top %llu Signatures out of %llu suitable xrefs for %I64X:\n", topLength, xrefSignatures.size( ), ea );
-	for( size_t i = 0; i < topLength; i++ ) {
-		const auto& [originAddress, signature] = xrefSignatures[i];
-		const auto signatureStr = FormatSignature( signature, sigType );
-		msg( "XREF Signature #%i @ %I64X: %s\n", i + 1, originAddress, signatureStr.c_str( ) );
+	const auto topSignatures = xrefSignatures.Sorted( );
+	msg( "Top %llu Signatures out of %llu suitable xrefs for %I64X:\n", topSignatures.size( ), xrefSignatures.OfferedCount( ), ea );
+	for( size_t i = 0; i < topSignatures.size( ); i++ ) {
+		const auto signatureStr = FormatSignature( topSignatures[i]->signature, sigType );
+		msg( "XREF Signature #%i @ %I64X: %s\n", i + 1, topSignatures[i]->ea, signatureStr.c_str( ) );
 
 		// Copy first signature only
 		if( i == 0 ) {
@@ -418,7 +133,7 @@ static void PrintSelectedCode( ea_t start, ea_t end, SignatureType sigType, bool
 	const auto selectionSize = end - start;
 	// Create signature of fixed size from selection
 
-	auto signature = GenerateSignatureForEARange( start, end, wildcardOperands, operandBitmask );
+	auto signature = GenerateSignatureForEARange( DATABASE, start, end, MakeGeneratorOptions( wildcardOperands, false, operandBitmask, 0 ) );
 	if( !signature.has_value( ) ) {
 		msg( "Error: %s\n", signature.error( ).c_str( ) );
 		return;
@@ -429,7 +144,63 @@ static void PrintSelectedCode( ea_t start, ea_t end, SignatureType sigType, bool
 	SetClipboardText( signatureStr );
 }
 
+static void PrintSignatureMatches( const std::string& signatureString, const Signature& signature, size_t targetOffset ) {
+	// Matches go to a chooser, printing tens of thousands of them would flood the output window
+	SEARCH_RESULTS.Search( signatureString, signature, targetOffset, MAX_SEARCH_RESULTS );
+}
+
+// Bytes followed by a full mask per byte like "0x8B, 0x40  0xFF, 0xF0", the only format with bit-level wildcards
+static bool ParseBytesWithMaskSignatureString( const std::string& input, Signature& signature ) {
+	std::smatch match;
+	if( !std::regex_search( input, match, std::regex( R"(((?:0x[0-9A-F]{2}, )+0x[0-9A-F]{2})\s+((?:0x[0-9A-F]{2}, )+0x[0-9A-F]{2}))", std::regex_constants::icase ) ) ) {
+		return false;
+	}
+
+	std::vector<std::string> byteStrings, maskStrings;
+	GetRegexMatches( match[1].str( ), std::regex( R"(0x[0-9A-F]{2})", std::regex_constants::icase ), byteStrings );
+	GetRegexMatches( match[2].str( ), std::regex( R"(0x[0-9A-F]{2})", std::regex_constants::icase ), maskStrings );
+	if( byteStrings.size( ) != maskStrings.size( ) ) {
+		return false;
+	}
+
+	signature.clear( );
+	for( size_t i = 0; i < byteStrings.size( ); i++ ) {
+		SignatureByte b{ static_cast<uint8_t>( std::stoi( byteStrings[i].substr( 2 ), nullptr, 16 ) ), false };
+		b.mask = static_cast<uint8_t>( std::stoi( maskStrings[i].substr( 2 ), nullptr, 16 ) );
+		if( b.mask == 0 ) {
+			b = { 0, true };
+		}
+		signature.push_back( b );
+	}
+	return true;
+}
+
 static void SearchSignatureString( std::string input ) {
+	// C++ pattern like sigmaker::Pattern<"E8 ? ? ? ? [45]">, the literal is an IDA style signature
+	std::smatch patternMatch;
+	if( std::regex_search( input, patternMatch, std::regex( R"re(Pattern<\s*"([^"]*)")re" ) ) ) {
+		input = patternMatch[1].str( );
+	}
+
+	// Offset of the target inside the signature, from a "// target offset 12" comment or a bracketed byte
+	size_t targetOffset = 0;
+	std::smatch targetMatch;
+	if( std::regex_search( input, targetMatch, std::regex( R"(target offset (\d+))" ) ) ) {
+		targetOffset = std::stoull( targetMatch[1].str( ) );
+		input = targetMatch.prefix( ).str( );
+	}
+	else if( const auto marker = input.find( '[' ); marker != std::string::npos ) {
+		std::istringstream tokens( input.substr( 0, marker ) );
+		targetOffset = std::distance( std::istream_iterator<std::string>( tokens ), std::istream_iterator<std::string>( ) );
+	}
+
+	// Bit-level wildcards can't be converted to IDA style, search for them directly
+	Signature maskedSignature;
+	if( ParseBytesWithMaskSignatureString( input, maskedSignature ) ) {
+		PrintSignatureMatches( BuildBytesWithBitmaskSignatureString( maskedSignature ), maskedSignature, targetOffset );
+		return;
+	}
+
 	// Try to figure out what signature type is used
 	// We will convert it to IDA style
 	std::string convertedSignatureString;
@@ -491,8 +262,8 @@ static void SearchSignatureString( std::string input ) {
 		// We need spaces between signature bytes, because we can not recognize if a signature uses one or two question marks per wildcard
 		input = std::regex_replace( input, std::regex( R"(\?\? )" ), "? " );
 
-		// Direct match for IDA type signature
-		if( std::regex_match( input, std::regex( R"((?:(?:[0-9A-F]{2}\s+)|(?:\?\s+))+)", std::regex_constants::icase ) ) ) {
+		// Direct match for IDA type signature, including nibble wildcards like "8?"
+		if( std::regex_match( input, std::regex( R"((?:(?:[0-9A-F?][0-9A-F]\s+)|(?:[0-9A-F]\?\s+)|(?:\?\s+))+)", std::regex_constants::icase ) ) ) {
 			// Just use it
 			convertedSignatureString = input;
 		}
@@ -534,15 +305,7 @@ static void SearchSignatureString( std::string input ) {
 	convertedSignatureString = std::regex_replace( convertedSignatureString, std::regex( "[? ]+$" ), "" );
 
 	// Print results
-	msg( "Results for %s:\n", convertedSignatureString.c_str( ) );
-	auto signatureMatches = FindSignatureOccurences( convertedSignatureString );
-	if( signatureMatches.empty( ) ) {
-		msg( "Signature does not match!\n" );
-		return;
-	}
-	for( const auto& ea : signatureMatches ) {
-		msg( "Match @ %I64X\n", ea );
-	}
+	PrintSignatureMatches( convertedSignatureString, ParseIDASignatureString( convertedSignatureString ), targetOffset );
 }
 
 static void ConfigureOperandWildcardBitmask( ) {
@@ -606,20 +369,166 @@ static void ConfigureOperandWildcardBitmask( ) {
 	}
 }
 
+static void ConfigureExternalImages( ) {
+	qstring pathList = GetExternalImagePathList( ).c_str( );
+	if( !ask_str( &pathList, HIST_FILE, "Additional binaries or dumps a signature has to be unique in (separated by ;)" ) ) {
+		return;
+	}
+
+	const auto failedPaths = LoadExternalImages( pathList.c_str( ) );
+	for( const auto& path : failedPaths ) {
+		msg( "Failed to map image %s\n", path.c_str( ) );
+	}
+	msg( "Signatures have to be unique in %llu additional image(s)\n", GetExternalImages( ).size( ) );
+}
+
+static void RunBenchmarks( ) {
+	BenchmarkOptions options;
+	options.engines = { ScanEngine::Native, ScanEngine::Reference, ScanEngine::Masked };
+	if( USE_QIS_SIGNATURE ) {
+		options.engines.push_back( ScanEngine::Qis );
+	}
+	options.operandTypeBitmask = WildcardableOperandTypeBitmask;
+	options.print = []( std::string_view line ) {
+		msg( "%s", std::string( line ).c_str( ) );
+	};
+
+	// Sample signature targets from function starts
+	std::vector<uint64_t> codeAddresses;
+	for( size_t i = 0; i < get_func_qty( ); i++ ) {
+		codeAddresses.push_back( getn_func( i )->start_ea );
+	}
+
+	show_wait_box( "Running benchmarks, this can take a while..." );
+
+	RunBenchmark( DATABASE, "current database", codeAddresses, options );
+
+	// The native search of stand-in images is the reference scanner
+	std::erase( options.engines, ScanEngine::Native );
+	constexpr size_t syntheticImageSizes[] = { 1 << 20, 16 << 20, 64 << 20 };
+	RunSyntheticBenchmarks( syntheticImageSizes, options );
+
+	hide_wait_box( );
+}
+
+static void VerifyEngines( ) {
+	VerificationOptions options;
+	options.engines = { ScanEngine::Native, ScanEngine::Masked };
+	if( USE_QIS_SIGNATURE ) {
+		options.engines.push_back( ScanEngine::Qis );
+	}
+	options.print = []( std::string_view line ) {
+		msg( "%s", std::string( line ).c_str( ) );
+	};
+
+	show_wait_box( "Verifying scan engines, this can take a while..." );
+
+	auto result = VerifyScanEngines( DATABASE, "current database", options );
+
+	// The native search of stand-in images is the reference scanner
+	std::erase( options.engines, ScanEngine::Native );
+	const auto standInResult = VerifyScanEnginesOnStandIns( options );
+	result.patterns += standInResult.patterns;
+	result.mismatches += standInResult.mismatches;
+
+	hide_wait_box( );
+
+	msg( "%s: %llu mismatches for %llu patterns\n", result.mismatches == 0 ? "PASSED" : "FAILED", result.mismatches, result.patterns );
+}
+
+static void ValidateOfflineDecoder( ) {
+	if( PROCESSOR_ARCH != PLFM_386 ) {
+		msg( "The built-in decoder only supports x86 and x64\n" );
+		return;
+	}
+
+	show_wait_box( "Comparing the built-in decoder with IDA, this can take a while..." );
+
+	// Decode every code head with both decoders, using the current wildcard settings
+	const auto useOfflineDecoder = DATABASE.useOfflineDecoder;
+	size_t instructionCount = 0, lengthMismatches = 0, wildcardMismatches = 0;
+	for( int i = 0; i < get_segm_qty( ) && !user_cancelled( ); i++ ) {
+		const auto segment = getnseg( i );
+		if( !segment ) {
+			continue;
+		}
+
+		for( auto ea = segment->start_ea; ea != BADADDR && ea < segment->end_ea; ea = next_head( ea, segment->end_ea ) ) {
+			if( !is_code( get_flags( ea ) ) ) {
+				continue;
+			}
+
+			DecodedInstruction idaInstruction, offlineInstruction;
+			DATABASE.useOfflineDecoder = false;
+			if( !DATABASE.DecodeInstruction( ea, WildcardableOperandTypeBitmask, WildcardGranularity::Byte, idaInstruction ) ) {
+				continue;
+			}
+			DATABASE.useOfflineDecoder = true;
+			const auto decoded = DATABASE.DecodeInstruction( ea, WildcardableOperandTypeBitmask, WildcardGranularity::Byte, offlineInstruction );
+			instructionCount++;
+
+			const bool lengthMismatch = !decoded || offlineInstruction.length != idaInstruction.length;
+			const bool wildcardMismatch = !lengthMismatch && ( offlineInstruction.operandOffset != idaInstruction.operandOffset || offlineInstruction.operandLength != idaInstruction.operandLength );
+			if( !lengthMismatch && !wildcardMismatch ) {
+				continue;
+			}
+
+			if( lengthMismatches + wildcardMismatches < 50 ) {
+				uint8_t bytes[16]{};
+				const auto byteCount = DATABASE.ReadBytes( ea, bytes, std::min( idaInstruction.length, sizeof( bytes ) ) );
+				std::string byteString;
+				for( size_t j = 0; j < byteCount; j++ ) {
+					byteString += std::format( " {:02X}", bytes[j] );
+				}
+				msg( "MISMATCH @ %I64X:%s IDA length %llu wildcard %u+%u, built-in %s %llu wildcard %u+%u\n", ea, byteString.c_str( ), idaInstruction.length, idaInstruction.operandOffset, idaInstruction.operandLength, decoded ? "length" : "invalid, length", offlineInstruction.length, offlineInstruction.operandOffset, offlineInstruction.operandLength );
+			}
+			lengthMismatch ? lengthMismatches++ : wildcardMismatches++;
+		}
+	}
+	DATABASE.useOfflineDecoder = useOfflineDecoder;
+
+	hide_wait_box( );
+
+	msg( "%s: %llu instructions, %llu length mismatches, %llu wildcard mismatches\n", lengthMismatches + wildcardMismatches == 0 ? "PASSED" : "FAILED", instructionCount, lengthMismatches, wildcardMismatches );
+}
+
+static void ShowStoredSignatures( ) {
+	const auto& entries = SIGNATURE_STORE.GetEntries( );
+	for( const auto& [ea, entry] : entries ) {
+		msg( "%I64X%s: %s\n", ea, entry.isStale ? " (stale)" : "", FormatSignature( entry.signature, SignatureType::IDA, entry.targetOffset ).c_str( ) );
+	}
+	msg( "%llu stored signatures\n", entries.size( ) );
+	if( !entries.empty( ) && ask_yn( ASKBTN_NO, "Delete all %llu stored signatures from this database?", entries.size( ) ) == ASKBTN_YES ) {
+		SIGNATURE_STORE.Clear( );
+	}
+}
+
 static void ConfigureOptions( ) {
 	const char format[] =
 		"STARTITEM 0\n"                                                         // TabStop
 		"Options\n"                                                             // Title
 		"<#Print top X shortest signatures when generating xref signatures#Print top X XREF signatures     :u::5::>\n"                           // Number 0
 		"<#Stop after reaching X bytes when generating a single signature#Maximum single signature length :u::5::>\n"							 // Number 1
-		"<#Stop after reaching X bytes when generating xref signatures#Maximum xref signature length   :u::5::>\n";                              // Number 2
-
-	if( ask_form( format, &PRINT_TOP_X, &MAX_SINGLE_SIGNATURE_LENGTH, &MAX_XREF_SIGNATURE_LENGTH ) ) {
+		"<#Stop after reaching X bytes when generating xref signatures#Maximum xref signature length   :u::5::>\n"                              // Number 2
+		"<#Give up on a signature after X milliseconds and print the best one so far, 0 for no limit#Time budget per signature (ms)  :u::5::>\n" // Number 3
+		"<#Stop generating xref signatures after X seconds and print the shortest ones so far, 0 for no limit#Xref deadline (seconds)         :u::5::>\n" // Number 4
+		"<#Stop searching a signature after X matches, 0 for no limit#Maximum search results          :u::8::>\n"                                  // Number 5
+		"<#Binaries or dumps of sibling builds that signatures have to be unique in as well#Cross-binary images...:B::::>\n"                 // Button 0
+		"<#Time searches and signature generation of every scan engine on this database and synthetic images#Benchmark...:B::::>\n"           // Button 1
+		"<#Check that every scan engine finds exactly the same matches as the reference scanner#Verify scan engines...:B::::>\n"    // Button 2
+		"<#Decode x86 and x64 instructions without IDA, so generation does not depend on the database's decoder#Use built-in x86 decoder:C>>\n" // Checkbox Button 0
+		"<#Compare the built-in decoder's lengths and wildcards with IDA for every instruction in this database#Validate built-in decoder...:B::::>\n" // Button 3
+		"<#List the signatures stored in this database, which repeated requests reuse until the bytes change#Stored signatures...:B::::>\n";   // Button 4
+
+	ushort decoderOptions = USE_OFFLINE_DECODER ? 1 : 0;
+	if( ask_form( format, &PRINT_TOP_X, &MAX_SINGLE_SIGNATURE_LENGTH, &MAX_XREF_SIGNATURE_LENGTH, &SIGNATURE_TIME_BUDGET_MS, &XREF_DEADLINE_SECONDS, &MAX_SEARCH_RESULTS, &ConfigureExternalImages, &RunBenchmarks, &VerifyEngines, &decoderOptions, &ValidateOfflineDecoder, &ShowStoredSignatures ) ) {
+		USE_OFFLINE_DECODER = decoderOptions & 1;
+		DATABASE.useOfflineDecoder = USE_OFFLINE_DECODER;
 	}
 }
 
-bool idaapi plugin_ctx_t::run( size_t ) {
-
+// Processor dependent defaults and database settings, shared by the menu and batch mode
+static void PrepareDatabase( ) {
 	// Check what processor we have
 	PROCESSOR_ARCH = get_ph( )->id;
 
@@ -651,6 +560,185 @@ bool idaapi plugin_ctx_t::run( size_t ) {
 	if( IsProcessorFeaturePresent( PF_AVX2_INSTRUCTIONS_AVAILABLE ) ) {
 		USE_QIS_SIGNATURE = true;
 	}
+	DATABASE.processorArch = PROCESSOR_ARCH;
+	DATABASE.is64Bit = compat_inf_is_64bit( );
+	DATABASE.useOfflineDecoder = USE_OFFLINE_DECODER;
+	DATABASE.scanEngine = USE_QIS_SIGNATURE ? ScanEngine::Qis : ScanEngine::Native;
+}
+
+// Recheck stored signatures one per tick, so the UI stays responsive. IDA's API may only be used on the main thread
+static int idaapi RecheckStoredSignatures( void* ) {
+	if( SIGNATURE_STORE.RecheckNext( ) ) {
+		return 10;
+	}
+	RecheckTimer = nullptr;
+	return -1;
+}
+
+// Copy a few MiB of segments per tick, so the first search after auto-analysis doesn't have to wait for the copy
+// Searches that come earlier use IDA's own search meanwhile
+static int idaapi WarmUpSegmentBuffer( void* ) {
+	if( DATABASE.WarmUpSegmentBuffer( 4 << 20 ) ) {
+		return 20;
+	}
+	WarmUpTimer = nullptr;
+	return -1;
+}
+
+static void ScheduleWarmUp( ) {
+	// Only the AVX2 scanner and the built-in decoder use the segment copy
+	if( !IsProcessorFeaturePresent( PF_AVX2_INSTRUCTIONS_AVAILABLE ) && !USE_OFFLINE_DECODER ) {
+		return;
+	}
+	if( WarmUpTimer != nullptr ) {
+		unregister_timer( WarmUpTimer );
+	}
+	WarmUpTimer = register_timer( 1000, WarmUpSegmentBuffer, nullptr );
+}
+
+// Batch mode for idat, one process per shard and a final one to merge, e.g.
+//   idat64 -A -OSigMaker:shard=3/16,out=C:\sigs\all.sig database.i64
+//   idat64 -A -OSigMaker:merge=16,out=C:\sigs\all.sig,format=ida database.i64
+static void RunBatch( const BatchOptions& options ) {
+	auto_wait( );
+	PrepareDatabase( );
+	if( options.memoryPlacement.largePages != LargePages::None || options.memoryPlacement.numa != NumaPlacement::None ) {
+		DATABASE.memoryPlacement = options.memoryPlacement;
+		// A copy the warm-up made before the options were known has the default placement
+		DATABASE.ResetSegmentBuffer( );
+	}
+	if( options.parallelScan ) {
+		ScanWorkers = std::make_unique<NodeWorkers>( options.threadsPerNode );
+		DATABASE.scanWorkers = ScanWorkers.get( );
+		// Native searches run inside IDA on this thread, the workers scan the segment copy
+		if( DATABASE.scanEngine == ScanEngine::Native ) {
+			DATABASE.scanEngine = ScanEngine::Masked;
+		}
+		msg( "Scanning with %llu threads on %llu NUMA nodes\n", ScanWorkers->ThreadCount( ), ScanWorkers->NodeCount( ) );
+	}
+	OutputWildcardGranularity = PARTIAL_WILDCARDS ? GetWildcardGranularity( options.outputType ) : WildcardGranularity::Byte;
+
+	std::expected<BatchResult, std::string> result;
+	if( options.merge ) {
+		msg( "Merging %llu shards into %s\n", options.shardCount, options.outputPath.c_str( ) );
+		result = MergeShards( DATABASE, options, []( std::string_view message ) {
+			msg( "%s", std::string( message ).c_str( ) );
+		} );
+	}
+	else {
+		std::vector<uint64_t> functionStarts;
+		functionStarts.reserve( get_func_qty( ) );
+		for( size_t i = 0; i < get_func_qty( ); i++ ) {
+			if( const auto func = getn_func( i ); func != nullptr ) {
+				functionStarts.push_back( func->start_ea );
+			}
+		}
+		const auto addresses = SelectShardAddresses( functionStarts, options );
+		msg( "Generating shard %llu/%llu: %llu of %llu functions\n", options.shardIndex, options.shardCount, addresses.size( ), functionStarts.size( ) );
+		result = GenerateShard( DATABASE, addresses, options, MakeGeneratorOptions( true, false, WildcardableOperandTypeBitmask, options.maxSignatureLength, false ) );
+	}
+
+	if( result.has_value( ) ) {
+		msg( "Batch done: %llu signatures, %llu failed, %llu conflicts\n", result->signatures, result->failed, result->conflicts );
+	}
+	else {
+		msg( "Batch failed: %s\n", result.error( ).c_str( ) );
+	}
+	if( !options.noExit ) {
+		qexit( result.has_value( ) ? 0 : 1 );
+	}
+}
+
+// HT_UI and HT_IDB notification codes overlap, so batch mode gets a listener of its own
+struct BatchListener : public event_listener_t {
+	BatchOptions options;
+	// Set if -OSigMaker: could not be parsed, the batch process then fails instead of opening the database interactively
+	std::string optionsError;
+
+	virtual ssize_t idaapi on_event( ssize_t code, va_list ) override {
+		if( code == ui_ready_to_run ) {
+			unhook_event_listener( HT_UI, this );
+			if( !optionsError.empty( ) ) {
+				msg( "Batch failed: invalid SigMaker options: %s\n", optionsError.c_str( ) );
+				qexit( 1 );
+			}
+			RunBatch( options );
+		}
+		return 0;
+	}
+};
+static BatchListener BATCH_LISTENER;
+
+plugin_ctx_t::plugin_ctx_t( ) {
+	hook_event_listener( HT_IDB, this );
+	if( auto_is_ok( ) ) {
+		ScheduleWarmUp( );
+	}
+
+	// -OSigMaker:<options> on the command line, run once the database is fully loaded
+	if( const auto batchOptions = get_plugin_options( "SigMaker" ); batchOptions != nullptr ) {
+		if( auto options = ParseBatchOptions( batchOptions ); options.has_value( ) ) {
+			BATCH_LISTENER.options = std::move( *options );
+		}
+		else {
+			msg( "Invalid SigMaker options: %s\n", options.error( ).c_str( ) );
+			BATCH_LISTENER.optionsError = std::move( options.error( ) );
+		}
+		hook_event_listener( HT_UI, &BATCH_LISTENER );
+	}
+}
+
+plugin_ctx_t::~plugin_ctx_t( ) {
+	unhook_event_listener( HT_IDB, this );
+	unhook_event_listener( HT_UI, &BATCH_LISTENER );
+	if( RecheckTimer != nullptr ) {
+		unregister_timer( RecheckTimer );
+		RecheckTimer = nullptr;
+	}
+	if( WarmUpTimer != nullptr ) {
+		unregister_timer( WarmUpTimer );
+		WarmUpTimer = nullptr;
+	}
+
+	// The segment copy, stored signatures and search results belong to the database that is being closed
+	SEARCH_RESULTS.Stop( );
+	DATABASE.ResetSegmentBuffer( );
+	SIGNATURE_STORE.Unload( );
+}
+
+ssize_t idaapi plugin_ctx_t::on_event( ssize_t code, va_list ) {
+	switch( code ) {
+	case idb_event::auto_empty_finally:
+		ScheduleWarmUp( );
+		break;
+	case idb_event::byte_patched:
+	case idb_event::segm_added:
+	case idb_event::segm_deleted:
+	case idb_event::segm_moved:
+		// A running search streams from the copy that is dropped here
+		if( SEARCH_RESULTS.IsRunning( ) ) {
+			SEARCH_RESULTS.Stop( );
+			msg( "Search stopped, the database changed\n" );
+		}
+		DATABASE.ResetSegmentBuffer( );
+		// Wait for a pause in patching before rechecking
+		SIGNATURE_STORE.ScheduleRecheck( );
+		if( RecheckTimer != nullptr ) {
+			unregister_timer( RecheckTimer );
+		}
+		RecheckTimer = register_timer( 1000, RecheckStoredSignatures, nullptr );
+		if( auto_is_ok( ) ) {
+			ScheduleWarmUp( );
+		}
+		break;
+	default:
+		break;
+	}
+	return 0;
+}
+
+bool idaapi plugin_ctx_t::run( size_t ) {
+	PrepareDatabase( );
 
 	// Show dialog
 	const char menuItems[] =
@@ -664,12 +752,15 @@ bool idaapi plugin_ctx_t::run( size_t ) {
 		"<#Example - E8 ? ? ? ? 45 33 F6 66 44 89 34 33#IDA Signature:R>\n"                                                                                           // Radio Button 0
 		"<#Example - E8 ?? ?? ?? ?? 45 33 F6 66 44 89 34 33#x64Dbg Signature:R>\n"                                                                                    // Radio Button 1
 		"<#Example - \\xE8\\x00\\x00\\x00\\x00\\x45\\x33\\xF6\\x66\\x44\\x89\\x34\\x33 x????xxxxxxxx#C Byte Array String Signature + String mask : R>\n"              // Radio Button 2
-		"<#Example - 0xE8, 0x00, 0x00, 0x00, 0x00, 0x45, 0x33, 0xF6, 0x66, 0x44, 0x89, 0x34, 0x33 0b1111111100001#C Bytes Signature + Bitmask:R>>\n"                  // Radio Button 3
+		"<#Example - 0xE8, 0x00, 0x00, 0x00, 0x00, 0x45, 0x33, 0xF6, 0x66, 0x44, 0x89, 0x34, 0x33 0b1111111100001#C Bytes Signature + Bitmask:R>\n"                   // Radio Button 3
+		"<#Example - sigmaker::Pattern for SigMakerPattern.hpp, parsed and specialized at compile time, E8 ? ? ? ? 45 33 F6 66 44 89 34 33#C++ Pattern:R>>\n"          // Radio Button 4
 
 		"Quick Options:\n"                                                                                                                                                  // Title
 		"<#Enable wildcarding for operands, to improve stability of created signatures#Wildcards for operands:C>\n"                                                   // Checkbox Button 0                                            
 		"<#Don't stop signature generation when reaching end of function#Continue when leaving function scope:C>\n"                                                   // Checkbox Button 1
-		"<#Wildcard the whole instruction when the operand (usually a register) is encoded into the operator#Wildcard optimized / combined instructions:C>>\n"        // Checkbox Button 2																										  // Checkbox Button 2
+		"<#Wildcard the whole instruction when the operand (usually a register) is encoded into the operator#Wildcard optimized / combined instructions:C>\n"        // Checkbox Button 2
+		"<#Only wildcard the bits of register fields, e.g. 8? or ?B, if the output format supports it#Nibble / bit wildcards:C>\n"                                    // Checkbox Button 3
+		"<#Also grow the signature backwards over preceding instructions, the output marks the target's offset#Grow in both directions:C>>\n"                         // Checkbox Button 4
 		"<#Configure operand types that should be wildcarded#Operand types...:B::::>"                                                                                 // Button 0
 		"<#Other options#Options...:B::::>\n";                                                                                                                        // Button 1
 
@@ -685,14 +776,18 @@ bool idaapi plugin_ctx_t::run( size_t ) {
 
 	static short action = 0;
 	static short outputFormat = 0;
-	static short options = ( 1 << 0 | 0 << 1 | WILDCARD_OPTIMIZED_INSTRUCTION << 2 );
+	static short options = ( 1 << 0 | 0 << 1 | WILDCARD_OPTIMIZED_INSTRUCTION << 2 | PARTIAL_WILDCARDS << 3 | GROW_BACKWARDS << 4 );
 
 	if( ask_form( formString.str( ).c_str( ), &action, &outputFormat, &options, &ConfigureOperandWildcardBitmask, &ConfigureOptions ) ) {
 		const auto wildcardOperands = options & ( 1 << 0 );
 		const auto continueOutsideOfFunction = options & ( 1 << 1 );
 		WILDCARD_OPTIMIZED_INSTRUCTION = options & ( 1 << 2 );
+		DATABASE.wildcardOptimizedInstruction = WILDCARD_OPTIMIZED_INSTRUCTION;
+		PARTIAL_WILDCARDS = options & ( 1 << 3 );
+		GROW_BACKWARDS = options & ( 1 << 4 );
 
 		const auto sigType = static_cast<SignatureType>( outputFormat );
+		OutputWildcardGranularity = PARTIAL_WILDCARDS ? GetWildcardGranularity( sigType ) : WildcardGranularity::Byte;
 		switch( action ) {
 		case 0:
 		{
@@ -701,7 +796,32 @@ bool idaapi plugin_ctx_t::run( size_t ) {
 
 			show_wait_box( "Generating signature..." );
 
-			auto signature = GenerateUniqueSignatureForEA( ea, wildcardOperands, continueOutsideOfFunction, WildcardableOperandTypeBitmask, MAX_SINGLE_SIGNATURE_LENGTH );
+			// Answer repeated requests from the signatures stored in the IDB
+			StoredSignatureOptions storeOptions;
+			storeOptions.flags = ( wildcardOperands ? StoredWildcardOperands : 0 ) | ( continueOutsideOfFunction ? StoredContinueOutsideOfFunction : 0 ) |
+				( WILDCARD_OPTIMIZED_INSTRUCTION ? StoredWildcardOptimizedInstruction : 0 ) | ( GROW_BACKWARDS ? StoredGrowBackwards : 0 );
+			storeOptions.operandTypeBitmask = WildcardableOperandTypeBitmask;
+			storeOptions.wildcardGranularity = static_cast<uint32_t>( OutputWildcardGranularity );
+			storeOptions.maxSignatureLength = static_cast<uint32_t>( std::min<size_t>( MAX_SINGLE_SIGNATURE_LENGTH, std::numeric_limits<uint32_t>::max( ) ) );
+			storeOptions.externalImagesHash = HashExternalImagePathList( GetExternalImagePathList( ) );
+			if( const auto stored = SIGNATURE_STORE.Find( ea, storeOptions ) ) {
+				msg( "Using stored signature\n" );
+				PrintSignatureForEA( TargetSignature{ stored->signature, stored->targetOffset }, ea, sigType );
+				hide_wait_box( );
+				break;
+			}
+
+			const auto generatorOptions = MakeGeneratorOptions( wildcardOperands, continueOutsideOfFunction, WildcardableOperandTypeBitmask, MAX_SINGLE_SIGNATURE_LENGTH );
+			std::expected<TargetSignature, std::string> signature;
+			if( GROW_BACKWARDS ) {
+				signature = GenerateUniqueSignatureAroundEA( DATABASE, ea, generatorOptions );
+			}
+			else {
+				signature = GenerateUniqueSignatureForEA( DATABASE, ea, generatorOptions ).transform( []( Signature s ) { return TargetSignature{ std::move( s ), 0 }; } );
+			}
+			if( signature.has_value( ) ) {
+				SIGNATURE_STORE.Store( ea, storeOptions, signature->signature, signature->targetOffset );
+			}
 			PrintSignatureForEA( signature, ea, sigType );
 
 			hide_wait_box( );
@@ -711,14 +831,15 @@ bool idaapi plugin_ctx_t::run( size_t ) {
 		{
 			// Find XREFs for current selection, generate signatures up to 250 bytes length
 			const auto ea = get_screen_ea( );
-			std::vector<std::tuple<ea_t, Signature>> xrefSignatures;
+			// Only the top X are kept, however many xrefs there are
+			ShortestSignatures xrefSignatures( PRINT_TOP_X );
 
 			show_wait_box( "Finding references and generating signatures. This can take a while..." );
 
 			FindXRefs( ea, wildcardOperands, continueOutsideOfFunction, xrefSignatures, MAX_XREF_SIGNATURE_LENGTH, WildcardableOperandTypeBitmask );
 
 			// Print top 5 shortest signatures
-			PrintXRefSignaturesForEA( ea, xrefSignatures, sigType, PRINT_TOP_X );
+			PrintXRefSignaturesForEA( ea, xrefSignatures, sigType );
 
 			hide_wait_box( );
 			break;
@@ -1,6 +1,7 @@
 #pragma once
 #include <ida.hpp>
 #include <idp.hpp>
+#include <auto.hpp>
 
 #include <loader.hpp>
 #include <search.hpp>
@@ -10,10 +11,12 @@
 
 // Plugin specific definitions
 
-struct plugin_ctx_t : public plugmod_t {
-    ~plugin_ctx_t( ) {
-    }
+struct plugin_ctx_t : public plugmod_t, public event_listener_t {
+    plugin_ctx_t( );
+    ~plugin_ctx_t( );
     virtual bool idaapi run( size_t ) override;
+    // Database changes that invalidate the segment copy and stored signatures
+    virtual ssize_t idaapi on_event( ssize_t code, va_list va ) override;
 };
 
 static plugmod_t* idaapi init( ) {
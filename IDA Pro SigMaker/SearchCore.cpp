@@ -0,0 +1,360 @@
+#include "SearchCore.h"
+#include "SignatureUtils.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <memory>
+
+#if defined( _M_X64 ) || defined( _M_IX86 ) || defined( __SSE2__ )
+#include <emmintrin.h>
+#define SIGMAKER_USE_SSE2 1
+#endif
+
+#define QIS_SIGNATURE_USE_AVX2 1 
+#include <qis/signature.hpp>
+
+bool ComputeByteHistogram( SegmentBuffer& buffer, const std::atomic<bool>* cancelled ) {
+    // Four tables, so consecutive equal bytes don't stall on the same counter
+    std::vector<uint64_t> counts( 4 * 256, 0 );
+    const auto data = buffer.data.data( );
+    const auto size = buffer.data.size( );
+    for( size_t chunk = 0; chunk < size; chunk += SCAN_CHUNK_SIZE ) {
+        if( cancelled != nullptr && cancelled->load( std::memory_order_relaxed ) ) {
+            return false;
+        }
+
+        const auto end = std::min( chunk + SCAN_CHUNK_SIZE, size );
+        size_t i = chunk;
+        for( ; i + 4 <= end; i += 4 ) {
+            counts[data[i]]++;
+            counts[256 + data[i + 1]]++;
+            counts[512 + data[i + 2]]++;
+            counts[768 + data[i + 3]]++;
+        }
+        for( ; i < end; i++ ) {
+            counts[data[i]]++;
+        }
+    }
+
+    buffer.byteHistogram.assign( 256, 0 );
+    for( size_t value = 0; value < 256; value++ ) {
+        buffer.byteHistogram[value] = counts[value] + counts[256 + value] + counts[512 + value] + counts[768 + value];
+    }
+    return true;
+}
+
+bool CancelToken::IsCancelled( ) const {
+    if( cancelled.load( std::memory_order_relaxed ) ) {
+        return true;
+    }
+
+    const auto now = Clock::now( );
+    if( now >= deadline ) {
+        return true;
+    }
+    if( poll && now - lastPoll >= POLL_INTERVAL ) {
+        lastPoll = now;
+        if( poll( ) ) {
+            cancelled.store( true, std::memory_order_relaxed );
+            return true;
+        }
+    }
+    return parent != nullptr && parent->IsCancelled( );
+}
+
+bool CancelToken::IsPastDeadline( ) const {
+    return Clock::now( ) >= deadline || ( parent != nullptr && parent->IsPastDeadline( ) );
+}
+
+SegmentBuffer CopySegmentBuffer( const SegmentBuffer& buffer, const MemoryPlacement& placement ) {
+    SegmentBuffer copy;
+    copy.data = SegmentMemory::Allocate( buffer.data.size( ), placement, SCAN_CHUNK_SIZE );
+    if( !buffer.data.empty( ) ) {
+        std::memcpy( copy.data.data( ), buffer.data.data( ), buffer.data.size( ) );
+    }
+    copy.blocks = buffer.blocks;
+    copy.byteHistogram = buffer.byteHistogram;
+    return copy;
+}
+
+size_t ReadFromSegmentBuffer( const SegmentBuffer& buffer, uint64_t ea, uint8_t* out, size_t size ) {
+    // Blocks are sorted by address, find the last one starting at or before the address
+    const auto block = std::ranges::upper_bound( buffer.blocks, ea, {}, &SegmentBuffer::Block::startEA );
+    if( block == buffer.blocks.begin( ) ) {
+        return 0;
+    }
+
+    const auto& containing = *std::prev( block );
+    const auto offset = ea - containing.startEA;
+    if( offset >= containing.size ) {
+        return 0;
+    }
+
+    const auto count = std::min<size_t>( size, containing.size - offset );
+    std::memcpy( out, buffer.data.data( ) + containing.offset + offset, count );
+    return count;
+}
+
+const char* GetScanEngineName( ScanEngine engine ) {
+    using enum ScanEngine;
+    switch( engine ) {
+    case Native:
+        return "Native";
+    case Reference:
+        return "Reference";
+    case Qis:
+        return "qis (AVX2)";
+    case Masked:
+        return "Masked (SSE2)";
+    }
+    return "Unknown";
+}
+
+static bool MatchesAt( const uint8_t* data, const Signature& signature ) {
+    for( size_t i = 0; i < signature.size( ); i++ ) {
+        if( !MatchesSignatureByte( data[i], signature[i] ) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Signature as value and mask arrays, padded to whole vectors
+struct MaskedPattern {
+    std::vector<uint8_t> values;
+    std::vector<uint8_t> masks;
+    size_t size = 0;
+    // Byte used to find candidates, the one with the most fixed bits
+    size_t anchorIndex = 0;
+};
+
+static MaskedPattern BuildMaskedPattern( const Signature& signature, const std::vector<uint64_t>& byteHistogram ) {
+    MaskedPattern pattern;
+    pattern.size = signature.size( );
+    const auto paddedSize = ( signature.size( ) + 15 ) & ~size_t( 15 );
+    pattern.values.resize( paddedSize, 0 );
+    pattern.masks.resize( paddedSize, 0 );
+
+    int anchorBits = -1;
+    auto anchorCount = std::numeric_limits<uint64_t>::max( );
+    for( size_t i = 0; i < signature.size( ); i++ ) {
+        pattern.masks[i] = GetMatchMask( signature[i] );
+        pattern.values[i] = signature[i].value & pattern.masks[i];
+
+        // Among fully fixed bytes, prefer the one that is rarest in the buffer
+        const auto bits = std::popcount( pattern.masks[i] );
+        const auto count = bits == 8 && !byteHistogram.empty( ) ? byteHistogram[pattern.values[i]] : std::numeric_limits<uint64_t>::max( );
+        if( bits > anchorBits || ( bits == anchorBits && count < anchorCount ) ) {
+            anchorBits = bits;
+            anchorCount = count;
+            pattern.anchorIndex = i;
+        }
+    }
+    return pattern;
+}
+
+static bool MatchesMaskedAt( const uint8_t* data, const MaskedPattern& pattern ) {
+    size_t i = 0;
+#ifdef SIGMAKER_USE_SSE2
+    for( ; i + 16 <= pattern.size; i += 16 ) {
+        const auto bytes = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + i ) );
+        const auto masked = _mm_and_si128( bytes, _mm_loadu_si128( reinterpret_cast<const __m128i*>( pattern.masks.data( ) + i ) ) );
+        const auto equal = _mm_cmpeq_epi8( masked, _mm_loadu_si128( reinterpret_cast<const __m128i*>( pattern.values.data( ) + i ) ) );
+        if( _mm_movemask_epi8( equal ) != 0xFFFF ) {
+            return false;
+        }
+    }
+#endif
+    for( ; i < pattern.size; i++ ) {
+        if( ( data[i] & pattern.masks[i] ) != pattern.values[i] ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void ScanBlockMasked( const uint8_t* data, size_t size, uint64_t startEA, const MaskedPattern& pattern, size_t limit, std::vector<uint64_t>& results ) {
+    if( pattern.size > size ) {
+        return;
+    }
+
+    const auto lastStart = size - pattern.size;
+    const auto anchorValue = pattern.values[pattern.anchorIndex];
+    const auto anchorMask = pattern.masks[pattern.anchorIndex];
+    size_t offset = 0;
+#ifdef SIGMAKER_USE_SSE2
+    // Test the anchor byte of 16 candidate positions at once
+    const auto anchorValues = _mm_set1_epi8( static_cast<char>( anchorValue ) );
+    const auto anchorMasks = _mm_set1_epi8( static_cast<char>( anchorMask ) );
+    for( ; offset + 16 <= lastStart + 1 && results.size( ) < limit; offset += 16 ) {
+        const auto bytes = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + offset + pattern.anchorIndex ) );
+        auto candidates = static_cast<uint32_t>( _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_and_si128( bytes, anchorMasks ), anchorValues ) ) );
+        while( candidates != 0 && results.size( ) < limit ) {
+            const auto candidate = offset + std::countr_zero( candidates );
+            candidates &= candidates - 1;
+            if( MatchesMaskedAt( data + candidate, pattern ) ) {
+                results.push_back( startEA + candidate );
+            }
+        }
+    }
+#endif
+    for( ; offset <= lastStart && results.size( ) < limit; offset++ ) {
+        if( ( data[offset + pattern.anchorIndex] & anchorMask ) == anchorValue && MatchesMaskedAt( data + offset, pattern ) ) {
+            results.push_back( startEA + offset );
+        }
+    }
+}
+
+static void ScanBlockReference( const uint8_t* data, size_t size, uint64_t startEA, const Signature& signature, size_t limit, std::vector<uint64_t>& results ) {
+    for( size_t offset = 0; offset + signature.size( ) <= size && results.size( ) < limit; offset++ ) {
+        if( MatchesAt( data + offset, signature ) ) {
+            results.push_back( startEA + offset );
+        }
+    }
+}
+
+static void ScanBlockQis( const uint8_t* data, size_t size, uint64_t startEA, const qis::signature& qisSignature, size_t limit, std::vector<uint64_t>& results ) {
+    size_t offset = 0;
+    while( offset < size && results.size( ) < limit ) {
+        auto occurence = qis::scan( data + offset, size - offset, qisSignature );
+
+        // Signature not found anymore
+        if( occurence == qis::npos ) {
+            break;
+        }
+
+        results.push_back( startEA + offset + occurence );
+        offset += occurence + 1;
+    }
+}
+
+using ChunkScanner = std::function<void( const uint8_t* data, size_t size, uint64_t startEA, size_t limit, std::vector<uint64_t>& results )>;
+
+// Scanner of the engine for the signature, prepared once per search
+static ChunkScanner MakeChunkScanner( const SegmentBuffer& buffer, const Signature& signature, ScanEngine engine ) {
+    // qis has no partial wildcards, the masked scanner handles those
+    const auto hasPartialWildcard = std::ranges::any_of( signature, IsPartialWildcard );
+    if( engine == ScanEngine::Qis && hasPartialWildcard ) {
+        engine = ScanEngine::Masked;
+    }
+
+    if( engine == ScanEngine::Masked ) {
+        return [pattern = BuildMaskedPattern( signature, buffer.byteHistogram )]( const uint8_t* data, size_t size, uint64_t startEA, size_t limit, std::vector<uint64_t>& results ) {
+            ScanBlockMasked( data, size, startEA, pattern, limit, results );
+        };
+    }
+
+    // qis needs at least one fixed byte, all wildcard patterns are handled by the reference scanner
+    const auto hasFixedByte = std::ranges::any_of( signature, []( const auto& sb ) { return !sb.isWildcard; } );
+    if( engine == ScanEngine::Qis && hasFixedByte ) {
+        // Create qis signature, qis uses double question marks
+        const auto qisSignature = std::make_shared<qis::signature>( BuildIDASignatureString( signature, true ) );
+        return [qisSignature]( const uint8_t* data, size_t size, uint64_t startEA, size_t limit, std::vector<uint64_t>& results ) {
+            ScanBlockQis( data, size, startEA, *qisSignature, limit, results );
+        };
+    }
+
+    return [&signature]( const uint8_t* data, size_t size, uint64_t startEA, size_t limit, std::vector<uint64_t>& results ) {
+        ScanBlockReference( data, size, startEA, signature, limit, results );
+    };
+}
+
+// Scans one chunk at a time, so cancellation is noticed within a chunk and a search can be resumed at a chunk
+// Each chunk covers the bytes of every match starting in it, so hits across chunk boundaries are found exactly once
+static bool ScanChunks( const SegmentBuffer& buffer, size_t patternSize, const ChunkScanner& scanChunk, ScanCursor& cursor, size_t maxBytes, size_t limit, std::vector<uint64_t>& results,
+                        const CancelToken* cancelToken ) {
+    size_t scanned = 0;
+    while( cursor.blockIndex < buffer.blocks.size( ) && results.size( ) < limit ) {
+        if( scanned >= maxBytes || ( cancelToken != nullptr && cancelToken->IsCancelled( ) ) ) {
+            return true;
+        }
+
+        const auto& block = buffer.blocks[cursor.blockIndex];
+        if( cursor.blockOffset < block.size ) {
+            const auto size = std::min( SCAN_CHUNK_SIZE + patternSize - 1, block.size - cursor.blockOffset );
+            scanChunk( buffer.data.data( ) + block.offset + cursor.blockOffset, size, block.startEA + cursor.blockOffset, limit, results );
+            cursor.blockOffset += SCAN_CHUNK_SIZE;
+            scanned += SCAN_CHUNK_SIZE;
+        }
+        if( cursor.blockOffset >= block.size ) {
+            cursor.blockIndex++;
+            cursor.blockOffset = 0;
+        }
+    }
+    return false;
+}
+
+std::vector<uint64_t> FindSignatureOccurencesInBuffer( const SegmentBuffer& buffer, const Signature& signature, ScanEngine engine, size_t limit, const CancelToken* cancelToken ) {
+    std::vector<uint64_t> results;
+    if( signature.empty( ) || limit == 0 ) {
+        return results;
+    }
+
+    ScanCursor cursor;
+    ScanChunks( buffer, signature.size( ), MakeChunkScanner( buffer, signature, engine ), cursor, std::numeric_limits<size_t>::max( ), limit, results, cancelToken );
+    return results;
+}
+
+std::vector<uint64_t> FindSignatureOccurencesInBufferParallel( const SegmentBuffer& buffer, const Signature& signature, ScanEngine engine, NodeWorkers& workers, size_t limit,
+                                                               const CancelToken* cancelToken ) {
+    std::vector<uint64_t> results;
+    if( signature.empty( ) || limit == 0 ) {
+        return results;
+    }
+
+    // Chunks end at multiples of SCAN_CHUNK_SIZE in the buffer rather than in the block, so each of them lies in a single stripe
+    struct Chunk {
+        size_t offset;
+        size_t size;
+        uint64_t startEA;
+    };
+    std::vector<Chunk> chunks;
+    for( const auto& block : buffer.blocks ) {
+        const auto blockEnd = block.offset + block.size;
+        for( size_t offset = block.offset; offset < blockEnd; ) {
+            const auto end = std::min( ( offset / SCAN_CHUNK_SIZE + 1 ) * SCAN_CHUNK_SIZE, blockEnd );
+            chunks.push_back( { offset, std::min( end + signature.size( ) - 1, blockEnd ) - offset, block.startEA + ( offset - block.offset ) } );
+            offset = end;
+        }
+    }
+
+    // The cancel token is only checked here, its poll callback may not be called from the workers
+    const auto scanChunk = MakeChunkScanner( buffer, signature, engine );
+    // Waves start with one chunk and double, so uniqueness checks that find their matches early don't scan a chunk per thread first
+    const size_t maxWaveSize = workers.ThreadCount( ) * 2;
+    size_t waveSize = limit == std::numeric_limits<size_t>::max( ) ? maxWaveSize : 1;
+    // A copy that was not placed per node, e.g. without NUMA placement, is spread over every node's workers in turn
+    const bool isPlaced = buffer.data.NodeCount( ) > 1;
+    std::vector<std::vector<uint64_t>> chunkResults;
+    for( size_t first = 0; first < chunks.size( ) && results.size( ) < limit; ) {
+        if( cancelToken != nullptr && cancelToken->IsCancelled( ) ) {
+            break;
+        }
+
+        const auto count = std::min( waveSize, chunks.size( ) - first );
+        const auto chunkLimit = limit - results.size( );
+        chunkResults.assign( count, { } );
+        workers.Run(
+            count, [&]( size_t index ) { return isPlaced ? buffer.data.GetNode( chunks[first + index].offset ) : first + index; },
+            [&]( size_t index ) {
+                const auto& chunk = chunks[first + index];
+                scanChunk( buffer.data.data( ) + chunk.offset, chunk.size, chunk.startEA, chunkLimit, chunkResults[index] );
+            } );
+
+        // Chunks are in address order, so appending their hits keeps the results ascending
+        for( const auto& hits : chunkResults ) {
+            const auto taken = std::min( hits.size( ), limit - results.size( ) );
+            results.insert( results.end( ), hits.begin( ), hits.begin( ) + taken );
+        }
+        first += count;
+        waveSize = std::min( waveSize * 2, maxWaveSize );
+    }
+    return results;
+}
+
+bool ContinueSignatureSearch( const SegmentBuffer& buffer, const Signature& signature, ScanEngine engine, ScanCursor& cursor, size_t maxBytes, size_t limit, std::vector<uint64_t>& results ) {
+    if( signature.empty( ) || results.size( ) >= limit ) {
+        return false;
+    }
+    return ScanChunks( buffer, signature.size( ), MakeChunkScanner( buffer, signature, engine ), cursor, maxBytes, limit, results, nullptr );
+}
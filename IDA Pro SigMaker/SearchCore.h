@@ -0,0 +1,111 @@
+#pragma once
+#include "SegmentMemory.h"
+#include "Signature.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+constexpr uint64_t BAD_ADDRESS = std::numeric_limits<uint64_t>::max( );
+
+// Granularity at which chunked scan engines split a block, hits across chunk boundaries must not be lost
+constexpr size_t SCAN_CHUNK_SIZE = 1 << 20;
+
+// Contiguous copy of all segments, with the mapping back to their addresses
+struct SegmentBuffer {
+    // Range of address-contiguous bytes inside the buffer, matches never cross blocks
+    struct Block {
+        uint64_t startEA;
+        size_t offset;
+        size_t size;
+    };
+
+    // Placed per chunk-sized stripe, see MemoryPlacement
+    SegmentMemory data;
+    std::vector<Block> blocks;
+    // Occurences of each byte value, empty until ComputeByteHistogram ran. Scanners anchor on rare bytes with it
+    std::vector<uint64_t> byteHistogram;
+
+    bool Empty( ) const {
+        return data.empty( );
+    }
+};
+
+// Cooperative cancellation with an optional wall-clock deadline
+// Scan kernels check it once per chunk and return the hits found so far, so a search that ran while it got cancelled is incomplete
+class CancelToken {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    CancelToken( ) = default;
+    // Cancelled along with its parent, e.g. a budget per address inside the deadline of a whole job
+    explicit CancelToken( const CancelToken* parent ) : parent( parent ) {
+    }
+
+    void Cancel( ) {
+        cancelled.store( true, std::memory_order_relaxed );
+    }
+    void SetDeadline( Clock::time_point time ) {
+        deadline = time;
+    }
+    void SetBudget( std::chrono::milliseconds budget ) {
+        deadline = Clock::now( ) + budget;
+    }
+
+    // Cancelled by Cancel or poll, or a deadline passed
+    bool IsCancelled( ) const;
+    // A deadline of this token or its parents passed, as opposed to being cancelled by the user
+    bool IsPastDeadline( ) const;
+
+    // Called by IsCancelled at most every POLL_INTERVAL, e.g. IDA's user_cancelled. Only runs on the thread that checks the token
+    std::function<bool( )> poll;
+    static constexpr auto POLL_INTERVAL = std::chrono::milliseconds( 50 );
+
+private:
+    const CancelToken* parent = nullptr;
+    mutable std::atomic<bool> cancelled = false;
+    Clock::time_point deadline = Clock::time_point::max( );
+    mutable Clock::time_point lastPoll{ };
+};
+
+// Scan engines, all of them have to produce the exact same results
+enum class ScanEngine : uint32_t {
+    Native = 0, // The database's own search, e.g. IDA's bin_search
+    Reference,  // Plain byte-by-byte comparison, used as ground truth
+    Qis,        // qis' AVX2 signature scanner, partial wildcards are handed to the masked scanner
+    Masked      // SSE2 masked compare, supports bit-level wildcards
+};
+
+// Count byte values of the buffer, returns false if cancelled
+bool ComputeByteHistogram( SegmentBuffer& buffer, const std::atomic<bool>* cancelled = nullptr );
+
+// Copy of the buffer with its bytes placed as requested, e.g. to compare placements
+SegmentBuffer CopySegmentBuffer( const SegmentBuffer& buffer, const MemoryPlacement& placement );
+
+// Copy bytes at the address out of the block containing it, returns the amount of bytes copied
+size_t ReadFromSegmentBuffer( const SegmentBuffer& buffer, uint64_t ea, uint8_t* out, size_t size );
+
+const char* GetScanEngineName( ScanEngine engine );
+
+// Find occurences of the signature in the buffer in ascending address order, stops after `limit` matches or once cancelToken is cancelled
+std::vector<uint64_t> FindSignatureOccurencesInBuffer( const SegmentBuffer& buffer, const Signature& signature, ScanEngine engine, size_t limit = std::numeric_limits<size_t>::max( ),
+                                                       const CancelToken* cancelToken = nullptr );
+
+// Same results as FindSignatureOccurencesInBuffer, with each chunk scanned by a worker of the node the chunk was placed on
+// Chunks are handed out in waves of a few per worker, so searches with a small limit don't scan the whole buffer
+std::vector<uint64_t> FindSignatureOccurencesInBufferParallel( const SegmentBuffer& buffer, const Signature& signature, ScanEngine engine, NodeWorkers& workers,
+                                                               size_t limit = std::numeric_limits<size_t>::max( ), const CancelToken* cancelToken = nullptr );
+
+// Position of a search that is spread over several calls
+struct ScanCursor {
+    size_t blockIndex = 0;
+    size_t blockOffset = 0;
+};
+
+// Continue a search at the cursor for about maxBytes of the buffer, in whole chunks, appending hits in ascending address order
+// Returns true while there is more to scan, so the first results can be shown before a search of a large image is done
+bool ContinueSignatureSearch( const SegmentBuffer& buffer, const Signature& signature, ScanEngine engine, ScanCursor& cursor, size_t maxBytes, size_t limit,
+                              std::vector<uint64_t>& results );
@@ -0,0 +1,113 @@
+#include "SearchResultsChooser.h"
+
+static constexpr const char* CHOOSER_TITLE = "Signature matches";
+static constexpr const char* const HEADER[] = { "Address", "Target", "Segment", "Function" };
+static constexpr int WIDTHS[] = { 16 | CHCOL_HEX, 16 | CHCOL_HEX, 10, 40 };
+
+// Bytes scanned per timer tick, small enough to keep the UI responsive with the slowest engine
+static constexpr size_t BYTES_PER_STEP = 4 * SCAN_CHUNK_SIZE;
+
+SearchResultsChooser::SearchResultsChooser( const Database& database ) : chooser_t( CH_KEEP | CH_CAN_REFRESH, qnumber( WIDTHS ), WIDTHS, HEADER, CHOOSER_TITLE ), database( database ) {
+}
+
+SearchResultsChooser::~SearchResultsChooser( ) {
+    Stop( );
+}
+
+void SearchResultsChooser::Search( const std::string& signatureString, const Signature& signature, size_t targetOffset, size_t maxResults ) {
+    Stop( );
+    this->signatureString = signatureString;
+    this->signature = signature;
+    this->targetOffset = targetOffset;
+    this->maxResults = maxResults == 0 ? std::numeric_limits<size_t>::max( ) : maxResults;
+    results.clear( );
+    cursor = { };
+
+    // Streaming needs the segment copy, IDA's own search can't be resumed. Every engine finds the same matches
+    // Without AVX2 there is no warm-up, copying all segments first would take longer than searching them once natively
+    useNativeSearch = database.scanEngine == ScanEngine::Native && !database.IsSegmentBufferReady( ) && !database.IsWarmingUp( );
+    engine = database.scanEngine == ScanEngine::Native ? ScanEngine::Masked : database.scanEngine;
+
+    msg( "Results for %s:\n", signatureString.c_str( ) );
+    // The first part right away, so the chooser doesn't open empty
+    if( Step( ) ) {
+        timer = register_timer( 1, OnTimer, this );
+    }
+    choose( );
+}
+
+void SearchResultsChooser::Stop( ) {
+    if( timer != nullptr ) {
+        unregister_timer( timer );
+        timer = nullptr;
+    }
+}
+
+bool SearchResultsChooser::Step( ) {
+    if( useNativeSearch ) {
+        results = database.FindOccurences( signature, maxResults );
+    }
+    else if( database.IsWarmingUp( ) ) {
+        // Wait for the warm-up to finish the copy instead of blocking on it
+        return true;
+    }
+    else if( ContinueSignatureSearch( database.GetSegmentBuffer( ), signature, engine, cursor, BYTES_PER_STEP, maxResults, results ) ) {
+        return true;
+    }
+
+    if( results.empty( ) ) {
+        msg( "Signature does not match!\n" );
+    }
+    else if( results.size( ) >= maxResults ) {
+        msg( "Stopped after %llu matches, the limit can be raised in Options\n", results.size( ) );
+    }
+    else {
+        msg( "%llu matches\n", results.size( ) );
+    }
+    return false;
+}
+
+int idaapi SearchResultsChooser::OnTimer( void* chooser ) {
+    auto& self = *static_cast<SearchResultsChooser*>( chooser );
+    const auto previousCount = self.results.size( );
+    const bool isRunning = self.Step( );
+    if( self.results.size( ) != previousCount ) {
+        refresh_chooser( CHOOSER_TITLE );
+    }
+    if( !isRunning ) {
+        self.timer = nullptr;
+        return -1;
+    }
+    return 1;
+}
+
+size_t idaapi SearchResultsChooser::get_count( ) const {
+    return results.size( );
+}
+
+void idaapi SearchResultsChooser::get_row( qstrvec_t* cols, int*, chooser_item_attrs_t*, size_t n ) const {
+    const auto ea = static_cast<ea_t>( results[n] );
+    ( *cols )[0].sprnt( "%llX", static_cast<uint64_t>( ea ) );
+    if( targetOffset != 0 ) {
+        ( *cols )[1].sprnt( "%llX", static_cast<uint64_t>( ea + targetOffset ) );
+    }
+    if( const auto segment = getseg( ea ); segment != nullptr ) {
+        get_segm_name( &( *cols )[2], segment );
+    }
+    get_func_name( &( *cols )[3], ea );
+}
+
+ea_t idaapi SearchResultsChooser::get_ea( size_t n ) const {
+    return n < results.size( ) ? static_cast<ea_t>( results[n] + targetOffset ) : BADADDR;
+}
+
+cbret_t idaapi SearchResultsChooser::enter( size_t n ) {
+    if( n < results.size( ) ) {
+        jumpto( static_cast<ea_t>( results[n] + targetOffset ) );
+    }
+    return cbret_t( n, chooser_base_t::NOTHING_CHANGED );
+}
+
+void idaapi SearchResultsChooser::closed( ) {
+    Stop( );
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "Plugin.h"
+#include "Database.h"
+#include <string>
+#include <vector>
+
+// Non-modal list of the matches of a searched signature, rows are only formatted when IDA shows them
+// The search runs in steps on a timer, so the first matches show up while the rest of a large image is scanned
+class SearchResultsChooser : public chooser_t {
+public:
+    explicit SearchResultsChooser( const Database& database );
+    ~SearchResultsChooser( );
+
+    // Replace the results with a search for the signature and show the chooser, stops after maxResults matches, 0 for no limit
+    void Search( const std::string& signatureString, const Signature& signature, size_t targetOffset, size_t maxResults );
+    // Stop a search that is still running, e.g. when the database is closed or its segment copy is dropped
+    void Stop( );
+    bool IsRunning( ) const {
+        return timer != nullptr;
+    }
+
+    size_t idaapi get_count( ) const override;
+    void idaapi get_row( qstrvec_t* cols, int* icon, chooser_item_attrs_t* attrs, size_t n ) const override;
+    ea_t idaapi get_ea( size_t n ) const override;
+    cbret_t idaapi enter( size_t n ) override;
+    void idaapi closed( ) override;
+
+private:
+    static int idaapi OnTimer( void* chooser );
+    // Scan the next part of the image, returns false once the search is done
+    bool Step( );
+
+    const Database& database;
+    ScanEngine engine = ScanEngine::Masked;
+    // IDA's own search in one go, for databases that have no segment copy to stream from
+    bool useNativeSearch = false;
+    std::string signatureString;
+    Signature signature;
+    size_t targetOffset = 0;
+    size_t maxResults = 0;
+    std::vector<uint64_t> results;
+    ScanCursor cursor;
+    qtimer_t timer = nullptr;
+};
@@ -0,0 +1,389 @@
+#include "SegmentMemory.h"
+#include <algorithm>
+#include <bit>
+#include <new>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#ifdef __linux__
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#endif
+
+static constexpr size_t SMALL_PAGE_SIZE = 4096;
+
+static size_t RoundUp( size_t value, size_t alignment ) {
+    return ( value + alignment - 1 ) / alignment * alignment;
+}
+
+// One thread per node writes to every page of its stripes before anyone else does, so the pages are allocated on that node
+static void TouchStripes( uint8_t* bytes, size_t mappedSize, size_t stripeSize, size_t nodeCount ) {
+    std::vector<std::thread> threads;
+    for( size_t node = 0; node < nodeCount; node++ ) {
+        threads.emplace_back( [=]( ) {
+            BindCurrentThreadToNode( node );
+            const auto pages = static_cast<volatile uint8_t*>( bytes );
+            for( size_t offset = node * stripeSize; offset < mappedSize; offset += nodeCount * stripeSize ) {
+                const auto end = std::min( offset + stripeSize, mappedSize );
+                for( size_t page = offset; page < end; page += SMALL_PAGE_SIZE ) {
+                    pages[page] = 0;
+                }
+            }
+        } );
+    }
+    for( auto& thread : threads ) {
+        thread.join( );
+    }
+}
+
+#ifdef _WIN32
+
+size_t GetNumaNodeCount( ) {
+    ULONG highestNode = 0;
+    return GetNumaHighestNodeNumber( &highestNode ) ? highestNode + 1 : 1;
+}
+
+size_t GetNodeProcessorCount( size_t node ) {
+    GROUP_AFFINITY affinity{ };
+    if( !GetNumaNodeProcessorMaskEx( static_cast<USHORT>( node ), &affinity ) ) {
+        return 0;
+    }
+    return std::popcount( static_cast<uint64_t>( affinity.Mask ) );
+}
+
+bool BindCurrentThreadToNode( size_t node ) {
+    GROUP_AFFINITY affinity{ };
+    return GetNumaNodeProcessorMaskEx( static_cast<USHORT>( node ), &affinity ) && affinity.Mask != 0 && SetThreadGroupAffinity( GetCurrentThread( ), &affinity, nullptr );
+}
+
+// Large pages need SeLockMemoryPrivilege, granted by the "Lock pages in memory" policy and enabled per process
+static bool EnableLockMemoryPrivilege( ) {
+    HANDLE token = nullptr;
+    if( !OpenProcessToken( GetCurrentProcess( ), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token ) ) {
+        return false;
+    }
+    TOKEN_PRIVILEGES privileges{ };
+    privileges.PrivilegeCount = 1;
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    // AdjustTokenPrivileges succeeds with ERROR_NOT_ALL_ASSIGNED if the policy does not grant it
+    const bool isEnabled = LookupPrivilegeValueA( nullptr, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid ) &&
+                           AdjustTokenPrivileges( token, FALSE, &privileges, 0, nullptr, nullptr ) && GetLastError( ) == ERROR_SUCCESS;
+    CloseHandle( token );
+    return isEnabled;
+}
+
+// Large pages are committed when allocated, so placing them per node takes one allocation per stripe at consecutive addresses
+static uint8_t* AllocateLargePageStripes( size_t mappedSize, size_t stripeSize, size_t largePageSize, size_t nodeCount ) {
+    // Find a free range and release it again, another thread may take it in between. That is a fallback to normal pages, not an error
+    const auto reserved = static_cast<uint8_t*>( VirtualAlloc( nullptr, mappedSize + largePageSize, MEM_RESERVE, PAGE_NOACCESS ) );
+    if( reserved == nullptr ) {
+        return nullptr;
+    }
+    const auto base = reinterpret_cast<uint8_t*>( RoundUp( reinterpret_cast<uintptr_t>( reserved ), largePageSize ) );
+    VirtualFree( reserved, 0, MEM_RELEASE );
+
+    for( size_t offset = 0; offset < mappedSize; offset += stripeSize ) {
+        const auto size = std::min( stripeSize, mappedSize - offset );
+        const auto node = static_cast<DWORD>( offset / stripeSize % nodeCount );
+        if( VirtualAllocExNuma( GetCurrentProcess( ), base + offset, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE, node ) == nullptr ) {
+            for( size_t allocated = 0; allocated < offset; allocated += stripeSize ) {
+                VirtualFree( base + allocated, 0, MEM_RELEASE );
+            }
+            return nullptr;
+        }
+    }
+    return base;
+}
+
+SegmentMemory SegmentMemory::Allocate( size_t size, const MemoryPlacement& placement, size_t chunkSize ) {
+    SegmentMemory memory;
+    if( size == 0 ) {
+        return memory;
+    }
+    memory.byteCount = size;
+    memory.nodeCount = placement.numa != NumaPlacement::None ? GetNumaNodeCount( ) : 1;
+
+    const size_t largePageSize = placement.largePages == LargePages::Explicit && EnableLockMemoryPrivilege( ) ? GetLargePageMinimum( ) : 0;
+    if( largePageSize != 0 ) {
+        memory.stripeSize = RoundUp( chunkSize, largePageSize );
+        memory.mappedSize = RoundUp( size, largePageSize );
+        if( memory.nodeCount > 1 ) {
+            memory.bytes = AllocateLargePageStripes( memory.mappedSize, memory.stripeSize, largePageSize, memory.nodeCount );
+            memory.isStriped = memory.bytes != nullptr;
+        }
+        else {
+            memory.bytes = static_cast<uint8_t*>( VirtualAlloc( nullptr, memory.mappedSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE ) );
+        }
+        memory.hasLargePages = memory.bytes != nullptr;
+    }
+
+    if( memory.bytes == nullptr ) {
+        // Committed normal pages are physically allocated on first touch, from the preferred node of their commit if there is one
+        memory.stripeSize = RoundUp( chunkSize, SMALL_PAGE_SIZE );
+        memory.mappedSize = RoundUp( size, SMALL_PAGE_SIZE );
+        memory.bytes = static_cast<uint8_t*>( VirtualAlloc( nullptr, memory.mappedSize, MEM_RESERVE, PAGE_READWRITE ) );
+        if( memory.bytes == nullptr ) {
+            throw std::bad_alloc( );
+        }
+        bool isCommitted = true;
+        if( placement.numa == NumaPlacement::Interleaved && memory.nodeCount > 1 ) {
+            for( size_t offset = 0; offset < memory.mappedSize && isCommitted; offset += memory.stripeSize ) {
+                isCommitted = VirtualAllocExNuma( GetCurrentProcess( ), memory.bytes + offset, std::min( memory.stripeSize, memory.mappedSize - offset ), MEM_COMMIT, PAGE_READWRITE,
+                                                  static_cast<DWORD>( memory.GetNode( offset ) ) ) != nullptr;
+            }
+        }
+        else {
+            isCommitted = VirtualAlloc( memory.bytes, memory.mappedSize, MEM_COMMIT, PAGE_READWRITE ) != nullptr;
+        }
+        if( !isCommitted ) {
+            throw std::bad_alloc( );
+        }
+    }
+
+    if( placement.numa == NumaPlacement::FirstTouch && memory.nodeCount > 1 && !memory.isStriped ) {
+        TouchStripes( memory.bytes, memory.mappedSize, memory.stripeSize, memory.nodeCount );
+    }
+    return memory;
+}
+
+void SegmentMemory::Release( ) {
+    if( bytes == nullptr ) {
+        return;
+    }
+    if( isStriped ) {
+        for( size_t offset = 0; offset < mappedSize; offset += stripeSize ) {
+            VirtualFree( bytes + offset, 0, MEM_RELEASE );
+        }
+    }
+    else {
+        VirtualFree( bytes, 0, MEM_RELEASE );
+    }
+    bytes = nullptr;
+}
+
+#else
+
+#ifdef __linux__
+// Processors of the node, from a list like "0-15,32-47"
+static std::vector<int> GetNodeProcessors( size_t node ) {
+    std::vector<int> processors;
+    std::ifstream file( "/sys/devices/system/node/node" + std::to_string( node ) + "/cpulist" );
+    std::string range;
+    while( std::getline( file, range, ',' ) ) {
+        int first = 0, last = 0;
+        const auto fields = std::sscanf( range.c_str( ), "%d-%d", &first, &last );
+        for( int processor = first; fields >= 1 && processor <= ( fields == 2 ? last : first ); processor++ ) {
+            processors.push_back( processor );
+        }
+    }
+    return processors;
+}
+
+static bool BindRangeToNode( void* address, size_t size, size_t node ) {
+    constexpr size_t MAX_NODES = 1024;
+    unsigned long nodeMask[MAX_NODES / ( 8 * sizeof( unsigned long ) )] = { };
+    if( node >= MAX_NODES ) {
+        return false;
+    }
+    nodeMask[node / ( 8 * sizeof( unsigned long ) )] |= 1ul << ( node % ( 8 * sizeof( unsigned long ) ) );
+    return syscall( SYS_mbind, address, size, MPOL_BIND, nodeMask, MAX_NODES, 0 ) == 0;
+}
+#endif
+
+size_t GetNumaNodeCount( ) {
+#ifdef __linux__
+    size_t count = 0;
+    while( std::ifstream( "/sys/devices/system/node/node" + std::to_string( count ) + "/cpulist" ).is_open( ) ) {
+        count++;
+    }
+    return std::max<size_t>( count, 1 );
+#else
+    return 1;
+#endif
+}
+
+size_t GetNodeProcessorCount( size_t node ) {
+#ifdef __linux__
+    if( const auto processors = GetNodeProcessors( node ); !processors.empty( ) ) {
+        return processors.size( );
+    }
+#endif
+    return node == 0 ? std::thread::hardware_concurrency( ) : 0;
+}
+
+bool BindCurrentThreadToNode( size_t node ) {
+#ifdef __linux__
+    cpu_set_t processorSet;
+    CPU_ZERO( &processorSet );
+    size_t count = 0;
+    for( const auto processor : GetNodeProcessors( node ) ) {
+        if( processor < CPU_SETSIZE ) {
+            CPU_SET( processor, &processorSet );
+            count++;
+        }
+    }
+    return count != 0 && sched_setaffinity( 0, sizeof( processorSet ), &processorSet ) == 0;
+#else
+    return false;
+#endif
+}
+
+SegmentMemory SegmentMemory::Allocate( size_t size, const MemoryPlacement& placement, size_t chunkSize ) {
+    constexpr size_t HUGE_PAGE_SIZE = 2 << 20;
+    SegmentMemory memory;
+    if( size == 0 ) {
+        return memory;
+    }
+    memory.byteCount = size;
+    memory.nodeCount = placement.numa != NumaPlacement::None ? GetNumaNodeCount( ) : 1;
+
+#ifdef MAP_HUGETLB
+    // Fails right away if too few huge pages are reserved, instead of faulting later
+    if( placement.largePages == LargePages::Explicit ) {
+        memory.mappedSize = RoundUp( size, HUGE_PAGE_SIZE );
+        const auto mapping = mmap( nullptr, memory.mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+        if( mapping != MAP_FAILED ) {
+            memory.bytes = static_cast<uint8_t*>( mapping );
+            memory.hasLargePages = true;
+        }
+    }
+#endif
+
+    if( memory.bytes == nullptr ) {
+        // Aligned to huge pages, so transparent huge pages can back the whole range
+        const size_t alignment = placement.largePages != LargePages::None ? HUGE_PAGE_SIZE : SMALL_PAGE_SIZE;
+        memory.mappedSize = RoundUp( size, alignment );
+        const auto mapping = mmap( nullptr, memory.mappedSize + alignment, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+        if( mapping == MAP_FAILED ) {
+            throw std::bad_alloc( );
+        }
+        memory.bytes = reinterpret_cast<uint8_t*>( RoundUp( reinterpret_cast<uintptr_t>( mapping ), alignment ) );
+        const size_t head = memory.bytes - static_cast<uint8_t*>( mapping );
+        if( head != 0 ) {
+            munmap( mapping, head );
+        }
+        munmap( memory.bytes + memory.mappedSize, alignment - head );
+#ifdef MADV_HUGEPAGE
+        if( placement.largePages != LargePages::None ) {
+            memory.hasLargePages = madvise( memory.bytes, memory.mappedSize, MADV_HUGEPAGE ) == 0;
+        }
+#endif
+    }
+    // Huge pages are never split between two nodes
+    memory.stripeSize = RoundUp( chunkSize, placement.largePages != LargePages::None ? HUGE_PAGE_SIZE : SMALL_PAGE_SIZE );
+
+#ifdef __linux__
+    if( placement.numa == NumaPlacement::Interleaved && memory.nodeCount > 1 ) {
+        for( size_t offset = 0; offset < memory.mappedSize; offset += memory.stripeSize ) {
+            BindRangeToNode( memory.bytes + offset, std::min( memory.stripeSize, memory.mappedSize - offset ), memory.GetNode( offset ) );
+        }
+    }
+#endif
+    if( placement.numa == NumaPlacement::FirstTouch && memory.nodeCount > 1 ) {
+        TouchStripes( memory.bytes, memory.mappedSize, memory.stripeSize, memory.nodeCount );
+    }
+    return memory;
+}
+
+void SegmentMemory::Release( ) {
+    if( bytes == nullptr ) {
+        return;
+    }
+    munmap( bytes, mappedSize );
+    bytes = nullptr;
+}
+
+#endif
+
+SegmentMemory::~SegmentMemory( ) {
+    Release( );
+}
+
+SegmentMemory::SegmentMemory( SegmentMemory&& other ) noexcept {
+    *this = std::move( other );
+}
+
+SegmentMemory& SegmentMemory::operator=( SegmentMemory&& other ) noexcept {
+    if( this != &other ) {
+        Release( );
+        bytes = std::exchange( other.bytes, nullptr );
+        byteCount = std::exchange( other.byteCount, 0 );
+        mappedSize = std::exchange( other.mappedSize, 0 );
+        stripeSize = std::exchange( other.stripeSize, 0 );
+        nodeCount = std::exchange( other.nodeCount, 1 );
+        hasLargePages = std::exchange( other.hasLargePages, false );
+        isStriped = std::exchange( other.isStriped, false );
+    }
+    return *this;
+}
+
+NodeWorkers::NodeWorkers( size_t threadsPerNode ) {
+    queues.resize( GetNumaNodeCount( ) );
+    for( size_t node = 0; node < queues.size( ); node++ ) {
+        // A node without processors still gets a worker, it just can't be bound to the node
+        const auto count = std::max<size_t>( threadsPerNode != 0 ? threadsPerNode : GetNodeProcessorCount( node ), 1 );
+        for( size_t i = 0; i < count; i++ ) {
+            threads.emplace_back( &NodeWorkers::WorkerLoop, this, node );
+        }
+    }
+}
+
+NodeWorkers::~NodeWorkers( ) {
+    {
+        std::lock_guard lock( mutex );
+        stopping = true;
+    }
+    wake.notify_all( );
+    for( auto& thread : threads ) {
+        thread.join( );
+    }
+}
+
+void NodeWorkers::Run( size_t taskCount, const std::function<size_t( size_t index )>& nodeOf, const std::function<void( size_t index )>& task ) {
+    if( taskCount == 0 ) {
+        return;
+    }
+    std::lock_guard runLock( runMutex );
+    std::unique_lock lock( mutex );
+    currentTask = &task;
+    remaining = taskCount;
+    for( size_t index = 0; index < taskCount; index++ ) {
+        queues[nodeOf( index ) % queues.size( )].push_back( index );
+    }
+    wake.notify_all( );
+    done.wait( lock, [this]( ) { return remaining == 0; } );
+    currentTask = nullptr;
+}
+
+void NodeWorkers::WorkerLoop( size_t node ) {
+    BindCurrentThreadToNode( node );
+    std::unique_lock lock( mutex );
+    while( true ) {
+        wake.wait( lock, [this, node]( ) { return stopping || !queues[node].empty( ); } );
+        if( stopping ) {
+            return;
+        }
+        const auto index = queues[node].front( );
+        queues[node].pop_front( );
+        const auto& task = *currentTask;
+
+        lock.unlock( );
+        task( index );
+        lock.lock( );
+        if( --remaining == 0 ) {
+            done.notify_all( );
+        }
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Page size of the segment copy
+enum class LargePages : uint32_t {
+    None = 0,
+    Transparent, // Linux transparent huge pages, same as None on Windows
+    Explicit     // MEM_LARGE_PAGES or MAP_HUGETLB, falls back to normal pages without the lock memory privilege or reserved huge pages
+};
+
+// How the segment copy is spread over NUMA nodes, stripe by stripe
+enum class NumaPlacement : uint32_t {
+    None = 0,    // Wherever the copying thread's node puts it
+    Interleaved, // Stripe i is allocated on node i % nodeCount
+    FirstTouch   // Stripe i is touched first by a thread on node i % nodeCount, so it lands where that node's workers scan it
+};
+
+struct MemoryPlacement {
+    LargePages largePages = LargePages::None;
+    NumaPlacement numa = NumaPlacement::None;
+};
+
+// NUMA topology, a single node on machines and systems without NUMA
+size_t GetNumaNodeCount( );
+size_t GetNodeProcessorCount( size_t node );
+// Restrict the calling thread to the processors of the node
+bool BindCurrentThreadToNode( size_t node );
+
+// Zero-filled, page-aligned bytes of the segment copy with a known NUMA node per stripe
+// Stripes are whole scan chunks, so a chunk never straddles two nodes
+class SegmentMemory {
+public:
+    SegmentMemory( ) = default;
+    ~SegmentMemory( );
+
+    SegmentMemory( SegmentMemory&& other ) noexcept;
+    SegmentMemory& operator=( SegmentMemory&& other ) noexcept;
+    SegmentMemory( const SegmentMemory& ) = delete;
+    SegmentMemory& operator=( const SegmentMemory& ) = delete;
+
+    // Throws std::bad_alloc if even normal pages can't be allocated
+    static SegmentMemory Allocate( size_t size, const MemoryPlacement& placement, size_t chunkSize );
+
+    uint8_t* data( ) {
+        return bytes;
+    }
+    const uint8_t* data( ) const {
+        return bytes;
+    }
+    size_t size( ) const {
+        return byteCount;
+    }
+    bool empty( ) const {
+        return byteCount == 0;
+    }
+    uint8_t& operator[]( size_t offset ) {
+        return bytes[offset];
+    }
+    const uint8_t& operator[]( size_t offset ) const {
+        return bytes[offset];
+    }
+
+    // Node the byte at the offset was placed on
+    size_t GetNode( size_t offset ) const {
+        return nodeCount > 1 ? offset / stripeSize % nodeCount : 0;
+    }
+    size_t NodeCount( ) const {
+        return nodeCount;
+    }
+    size_t StripeSize( ) const {
+        return stripeSize;
+    }
+    bool HasLargePages( ) const {
+        return hasLargePages;
+    }
+
+private:
+    void Release( );
+
+    uint8_t* bytes = nullptr;
+    size_t byteCount = 0;
+    size_t mappedSize = 0;
+    size_t stripeSize = 0;
+    size_t nodeCount = 1;
+    bool hasLargePages = false;
+    // Large pages placed per node are separate allocations, one per stripe
+    bool isStriped = false;
+};
+
+// Worker threads bound to NUMA nodes, each task runs on a worker of the node its data was placed on
+class NodeWorkers {
+public:
+    // 0 starts one worker per processor of each node
+    explicit NodeWorkers( size_t threadsPerNode = 0 );
+    ~NodeWorkers( );
+
+    NodeWorkers( const NodeWorkers& ) = delete;
+    NodeWorkers& operator=( const NodeWorkers& ) = delete;
+
+    size_t NodeCount( ) const {
+        return queues.size( );
+    }
+    size_t ThreadCount( ) const {
+        return threads.size( );
+    }
+
+    // Run task( index ) for every index below taskCount on a worker of node nodeOf( index ) % NodeCount( ), returns once all of them are done
+    void Run( size_t taskCount, const std::function<size_t( size_t index )>& nodeOf, const std::function<void( size_t index )>& task );
+
+private:
+    void WorkerLoop( size_t node );
+
+    std::mutex runMutex;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::vector<std::deque<size_t>> queues;
+    std::vector<std::thread> threads;
+    const std::function<void( size_t index )>* currentTask = nullptr;
+    size_t remaining = 0;
+    bool stopping = false;
+};
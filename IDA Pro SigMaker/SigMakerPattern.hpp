@@ -0,0 +1,281 @@
+#pragma once
+// Header-only scanner for the "C++ Pattern" output format, requires C++20 and has no other dependencies
+//
+//   using CreateMove = sigmaker::Pattern<"48 89 5C 24 ? 57 48 83 EC 30 [E8] ? ? ? ?">;
+//   const uint8_t* match = CreateMove::Find( moduleBase, moduleSize );  // Start of the match, or nullptr
+//   const uint8_t* target = CreateMove::FindTarget( moduleBase, moduleSize );  // Bracketed byte of the match
+//
+// The pattern is parsed at compile time. Matching is unrolled over the fixed bytes only and candidates are found
+// with a SIMD compare of the two rarest fixed bytes, so every pattern gets its own specialized matcher
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#if defined( __AVX2__ )
+#include <immintrin.h>
+#define SIGMAKER_PATTERN_VECTOR_SIZE 32
+#elif defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define SIGMAKER_PATTERN_VECTOR_SIZE 16
+#else
+#define SIGMAKER_PATTERN_VECTOR_SIZE 0
+#endif
+
+namespace sigmaker {
+
+// String literal as template argument
+template <size_t N>
+struct FixedString {
+    char text[N];
+
+    consteval FixedString( const char ( &str )[N] ) {
+        for( size_t i = 0; i < N; i++ ) {
+            text[i] = str[i];
+        }
+    }
+};
+
+struct PatternByte {
+    uint8_t value = 0;
+    // Bits that have to match, 0 for wildcards and 0x0F / 0xF0 for nibble wildcards like "?B" or "8?"
+    uint8_t mask = 0;
+};
+
+namespace detail {
+
+consteval bool IsSpace( char c ) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+consteval int HexValue( char c ) {
+    if( c >= '0' && c <= '9' ) {
+        return c - '0';
+    }
+    if( c >= 'A' && c <= 'F' ) {
+        return c - 'A' + 10;
+    }
+    if( c >= 'a' && c <= 'f' ) {
+        return c - 'a' + 10;
+    }
+    // Not a constant expression, so an invalid pattern fails to compile
+    throw "Invalid character in pattern";
+}
+
+// A pattern has fewer bytes than its text has characters
+template <size_t N>
+struct ParsedPattern {
+    std::array<PatternByte, N> bytes{ };
+    size_t size = 0;
+    size_t targetOffset = 0;
+};
+
+// Tokens are "E8", "?", "??", "8?" or "?B", one of them may be bracketed to mark the target
+template <size_t N>
+consteval ParsedPattern<N> ParsePattern( const FixedString<N>& pattern ) {
+    ParsedPattern<N> result;
+    size_t i = 0;
+    while( i + 1 < N ) {
+        if( IsSpace( pattern.text[i] ) || pattern.text[i] == ']' ) {
+            i++;
+            continue;
+        }
+        if( pattern.text[i] == '[' ) {
+            result.targetOffset = result.size;
+            i++;
+            continue;
+        }
+
+        size_t end = i;
+        while( end + 1 < N && !IsSpace( pattern.text[end] ) && pattern.text[end] != ']' ) {
+            end++;
+        }
+
+        PatternByte byte;
+        if( end - i == 2 ) {
+            const auto high = pattern.text[i];
+            const auto low = pattern.text[i + 1];
+            if( high != '?' ) {
+                byte.value |= static_cast<uint8_t>( HexValue( high ) << 4 );
+                byte.mask |= 0xF0;
+            }
+            if( low != '?' ) {
+                byte.value |= static_cast<uint8_t>( HexValue( low ) );
+                byte.mask |= 0x0F;
+            }
+        }
+        else if( end - i != 1 || pattern.text[i] != '?' ) {
+            throw "Pattern bytes need two hex digits";
+        }
+        result.bytes[result.size++] = byte;
+        i = end;
+    }
+    return result;
+}
+
+// Rough frequency of byte values in x86 code, lower is rarer
+constexpr int ByteCommonness( uint8_t value ) {
+    switch( value ) {
+    case 0x00:
+    case 0xFF:
+    case 0xCC:
+        return 4;
+    case 0x48:
+    case 0x89:
+    case 0x8B:
+    case 0x0F:
+    case 0x24:
+    case 0x90:
+        return 3;
+    case 0x4C:
+    case 0x8D:
+    case 0x83:
+    case 0xE8:
+    case 0x44:
+    case 0x01:
+    case 0x41:
+    case 0x40:
+    case 0xC3:
+    case 0x74:
+    case 0x75:
+    case 0xEB:
+        return 2;
+    default:
+        return 1;
+    }
+}
+
+} // namespace detail
+
+template <FixedString Text>
+class Pattern {
+    static constexpr auto Parsed = detail::ParsePattern( Text );
+
+public:
+    static constexpr size_t Size = Parsed.size;
+    // Offset of the bracketed byte, 0 if there is none
+    static constexpr size_t TargetOffset = Parsed.targetOffset;
+
+    static constexpr std::array<PatternByte, Size> Bytes = [] {
+        std::array<PatternByte, Size> bytes{ };
+        for( size_t i = 0; i < Size; i++ ) {
+            bytes[i] = Parsed.bytes[i];
+        }
+        return bytes;
+    }( );
+
+private:
+    static_assert( Size > 0, "Empty pattern" );
+
+    static constexpr size_t NoAnchor = ~size_t( 0 );
+
+    // Fully fixed bytes that candidates are searched by, the rarest ones and as far apart as possible
+    static constexpr std::pair<size_t, size_t> Anchors = [] {
+        size_t first = NoAnchor, second = NoAnchor;
+        for( size_t i = 0; i < Size; i++ ) {
+            if( Bytes[i].mask == 0xFF && ( first == NoAnchor || detail::ByteCommonness( Bytes[i].value ) < detail::ByteCommonness( Bytes[first].value ) ) ) {
+                first = i;
+            }
+        }
+        for( size_t i = 0; first != NoAnchor && i < Size; i++ ) {
+            if( i == first || Bytes[i].mask != 0xFF ) {
+                continue;
+            }
+            const auto distance = []( size_t a, size_t b ) { return a > b ? a - b : b - a; };
+            if( second == NoAnchor || detail::ByteCommonness( Bytes[i].value ) < detail::ByteCommonness( Bytes[second].value ) ||
+                ( detail::ByteCommonness( Bytes[i].value ) == detail::ByteCommonness( Bytes[second].value ) && distance( i, first ) > distance( second, first ) ) ) {
+                second = i;
+            }
+        }
+        return std::pair{ first, second };
+    }( );
+
+    template <size_t... I>
+    static bool MatchesAt( const uint8_t* data, std::index_sequence<I...> ) noexcept {
+        // Wildcards have a zero mask, the compiler drops their comparisons
+        return ( ( ( data[I] & Bytes[I].mask ) == Bytes[I].value ) && ... );
+    }
+
+#if SIGMAKER_PATTERN_VECTOR_SIZE == 32
+    using Vector = __m256i;
+    static Vector Broadcast( uint8_t value ) noexcept {
+        return _mm256_set1_epi8( static_cast<char>( value ) );
+    }
+    static uint32_t CompareBytes( const uint8_t* data, Vector value ) noexcept {
+        return static_cast<uint32_t>( _mm256_movemask_epi8( _mm256_cmpeq_epi8( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( data ) ), value ) ) );
+    }
+#elif SIGMAKER_PATTERN_VECTOR_SIZE == 16
+    using Vector = __m128i;
+    static Vector Broadcast( uint8_t value ) noexcept {
+        return _mm_set1_epi8( static_cast<char>( value ) );
+    }
+    static uint32_t CompareBytes( const uint8_t* data, Vector value ) noexcept {
+        return static_cast<uint32_t>( _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>( data ) ), value ) ) );
+    }
+#endif
+
+public:
+    static bool MatchesAt( const uint8_t* data ) noexcept {
+        return MatchesAt( data, std::make_index_sequence<Size>( ) );
+    }
+
+    // First match in the range, or nullptr
+    static const uint8_t* Find( const uint8_t* data, size_t size ) noexcept {
+        if( size < Size ) {
+            return nullptr;
+        }
+        const size_t lastStart = size - Size;
+        size_t offset = 0;
+
+#if SIGMAKER_PATTERN_VECTOR_SIZE != 0
+        // Kernel per pattern: two anchors, one anchor, or none at all for wildcard-only patterns
+        if constexpr( Anchors.first != NoAnchor ) {
+            constexpr size_t VectorSize = SIGMAKER_PATTERN_VECTOR_SIZE;
+            const auto firstValue = Broadcast( Bytes[Anchors.first].value );
+            [[maybe_unused]] const auto secondValue = Broadcast( Anchors.second != NoAnchor ? Bytes[Anchors.second].value : 0 );
+            for( ; offset + VectorSize <= lastStart + 1; offset += VectorSize ) {
+                auto candidates = CompareBytes( data + offset + Anchors.first, firstValue );
+                if constexpr( Anchors.second != NoAnchor ) {
+                    candidates &= CompareBytes( data + offset + Anchors.second, secondValue );
+                }
+                while( candidates != 0 ) {
+                    const auto candidate = data + offset + std::countr_zero( candidates );
+                    if( MatchesAt( candidate ) ) {
+                        return candidate;
+                    }
+                    candidates &= candidates - 1;
+                }
+            }
+        }
+#endif
+
+        for( ; offset <= lastStart; offset++ ) {
+            if( MatchesAt( data + offset ) ) {
+                return data + offset;
+            }
+        }
+        return nullptr;
+    }
+
+    // Bracketed byte of the first match, or nullptr
+    static const uint8_t* FindTarget( const uint8_t* data, size_t size ) noexcept {
+        const auto match = Find( data, size );
+        return match != nullptr ? match + TargetOffset : nullptr;
+    }
+
+    // Calls callback( const uint8_t* match ) for every match, stops early if it returns false
+    template <typename Callback>
+    static void FindAll( const uint8_t* data, size_t size, Callback&& callback ) {
+        size_t offset = 0;
+        while( offset < size ) {
+            const auto match = Find( data + offset, size - offset );
+            if( match == nullptr || !callback( match ) ) {
+                return;
+            }
+            offset = static_cast<size_t>( match - data ) + 1;
+        }
+    }
+};
+
+} // namespace sigmaker
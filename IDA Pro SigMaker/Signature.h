@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Signature types and structures
+enum class SignatureType : uint32_t {
+    IDA = 0,
+    x64Dbg,
+    Signature_Mask,
+    SignatureByteArray_Bitmask,
+    // sigmaker::Pattern<"..."> for SigMakerPattern.hpp, parsed at compile time
+    CppPattern
+};
+
+// Smallest wildcard an output format can express
+enum class WildcardGranularity : uint32_t {
+    Byte = 0,
+    Nibble,
+    Bit
+};
+
+typedef struct {
+    uint8_t value;
+    bool isWildcard;
+    // Bits that have to match, for partial wildcards like "8?". Ignored for whole-byte wildcards
+    uint8_t mask = 0xFF;
+} SignatureByte;
+
+using Signature = std::vector<SignatureByte>;
+
+// Bits of the byte that have to match, 0 for whole-byte wildcards
+inline uint8_t GetMatchMask( const SignatureByte& byte ) {
+    return byte.isWildcard ? 0 : byte.mask;
+}
+
+inline bool MatchesSignatureByte( uint8_t data, const SignatureByte& byte ) {
+    return ( ( data ^ byte.value ) & GetMatchMask( byte ) ) == 0;
+}
+
+inline bool IsPartialWildcard( const SignatureByte& byte ) {
+    return !byte.isWildcard && byte.mask != 0xFF;
+}
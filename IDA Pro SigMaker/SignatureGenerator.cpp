@@ -0,0 +1,765 @@
+#include "SignatureGenerator.h"
+#include "SignatureUtils.h"
+#include "ExternalImages.h"
+#include <algorithm>
+#include <format>
+#include <optional>
+#include <unordered_map>
+
+static void Log( const GeneratorOptions& options, std::string_view message ) {
+    if( options.log ) {
+        options.log( message );
+    }
+}
+
+// Token for generating one signature: the caller's cancel callback and budget, within the job's token
+static void ConfigureCancelToken( CancelToken& token, const GeneratorOptions& options ) {
+    token.poll = options.isCancelled;
+    if( options.timeBudgetMs > 0 ) {
+        token.SetBudget( std::chrono::milliseconds( options.timeBudgetMs ) );
+    }
+}
+
+static std::string GetStopReason( const CancelToken& token ) {
+    return token.IsPastDeadline( ) ? "Time budget exceeded" : "Aborted";
+}
+
+// Add the bytes of an instruction to the signature, wildcarding its operand if there is one
+static void AddInstructionToSignature( Signature& signature, const Database& database, uint64_t address, const DecodedInstruction& instruction, WildcardGranularity granularity ) {
+    if( granularity != WildcardGranularity::Byte && instruction.hasMatchMasks ) {
+        // Only wildcard the bits of the operands, as far as the output format can express it
+        const auto previousSize = signature.size( );
+        AddBytesToSignature( signature, database, address, instruction.length, false );
+        for( size_t i = 0; i < instruction.length; i++ ) {
+            auto& byte = signature[previousSize + i];
+            byte.mask = instruction.matchMasks[i];
+            ApplyWildcardGranularity( byte, granularity );
+        }
+    }
+    else if( instruction.operandLength > 0 ) {
+        // Add opcodes
+        AddBytesToSignature( signature, database, address, instruction.operandOffset, false );
+        // Wildcards for operands
+        AddBytesToSignature( signature, database, address + instruction.operandOffset, instruction.operandLength, true );
+        // If the operand is on the "left side", add the operator from the "right side"
+        if( instruction.operandOffset == 0 ) {
+            AddBytesToSignature( signature, database, address + instruction.operandLength, instruction.length - instruction.operandLength, false );
+        }
+    }
+    else {
+        // No operand, add all bytes
+        AddBytesToSignature( signature, database, address, instruction.length, false );
+    }
+}
+
+// The signature also has to match exactly once in every additional image
+// Returns an error if an image has no match, growing the signature only removes matches so it can not be fixed anymore
+static std::expected<bool, std::string> IsUniqueInExternalImages( const Signature& signature ) {
+    const auto imageOccurences = CountSignatureOccurencesInImages( signature, 2 );
+    if( const auto it = std::ranges::find( imageOccurences, 0 ); it != imageOccurences.end( ) ) {
+        const auto& imagePath = GetExternalImages( )[it - imageOccurences.begin( )]->Path( );
+        return std::unexpected( std::format( "Signature does not match in {}", imagePath ) );
+    }
+    return std::ranges::all_of( imageOccurences, []( size_t count ) { return count == 1; } );
+}
+
+std::expected<Signature, std::string> GenerateUniqueSignatureForEA( const Database& database, uint64_t ea, const GeneratorOptions& options ) {
+    Signature signature;
+    if( auto result = GenerateUniqueSignatureForEA( database, ea, options, signature ); !result.has_value( ) ) {
+        return std::unexpected( std::move( result.error( ) ) );
+    }
+    return signature;
+}
+
+std::expected<void, std::string> GenerateUniqueSignatureForEA( const Database& database, uint64_t ea, const GeneratorOptions& options, Signature& signature ) {
+    signature.clear( );
+    if( ea == BAD_ADDRESS ) {
+        return std::unexpected( "Invalid address" );
+    }
+
+    if( !database.IsCode( ea ) ) {
+        return std::unexpected( "Can not create code signature for data" );
+    }
+
+    size_t sigPartLength = 0;
+
+    const auto operandTypeBitmask = options.wildcardOperands ? options.operandTypeBitmask : 0;
+    const auto currentFunction = database.GetFunctionStart( ea );
+    CancelToken cancelToken( options.jobToken );
+    ConfigureCancelToken( cancelToken, options );
+
+    auto currentAddress = ea;
+    while( true ) {
+        // Handle "cancel" event, also checked inside the searches
+        if( cancelToken.IsCancelled( ) ) {
+            if( cancelToken.IsPastDeadline( ) && !signature.empty( ) ) {
+                // Best we got within the budget
+                Log( options, std::format( "NOT UNIQUE Signature for {:X} when the time ran out: {}\n", ea, BuildIDASignatureString( signature ) ) );
+            }
+            return std::unexpected( GetStopReason( cancelToken ) );
+        }
+
+        DecodedInstruction instruction;
+        if( !database.DecodeInstruction( currentAddress, operandTypeBitmask, options.wildcardGranularity, instruction ) || instruction.length == 0 ) {
+            if( signature.empty( ) ) {
+                return std::unexpected( "Failed to decode first instruction" );
+            }
+
+            Log( options, std::format( "Signature reached end of executable code @ {:X}\n", currentAddress ) );
+            Log( options, std::format( "NOT UNIQUE Signature for {:X}: {}\n", ea, BuildIDASignatureString( signature ) ) );
+            return std::unexpected( "Signature not unique" );
+        }
+
+        // Length check in case the signature becomes too long
+        if( sigPartLength > options.maxSignatureLength ) {
+            if( options.askLongerSignature ) {
+                auto result = options.askLongerSignature( signature.size( ) );
+                if( result == 1 ) { // Yes 
+                    sigPartLength = 0;
+                }
+                else if( result == 0 ) { // No
+                    // Print the signature we have so far, even though its not unique
+                    Log( options, std::format( "NOT UNIQUE Signature for {:X}: {}\n", ea, BuildIDASignatureString( signature ) ) );
+                    return std::unexpected( "Signature not unique" );
+                }
+                else { // Cancel
+                    return std::unexpected( "Aborted" );
+                }
+            }
+            else {
+                return std::unexpected( "Signature exceeded maximum length" );
+            }
+        }
+        sigPartLength += instruction.length;
+
+        // Check current instruction, add its bytes to the signature accordingly
+        AddInstructionToSignature( signature, database, currentAddress, instruction, options.wildcardGranularity );
+
+        // A cancelled search is incomplete, the check above ends generation on the next iteration
+        if( database.FindOccurences( signature, 2, &cancelToken ).size( ) == 1 && !cancelToken.IsCancelled( ) ) {
+            const auto uniqueInImages = IsUniqueInExternalImages( signature );
+            if( !uniqueInImages.has_value( ) ) {
+                return std::unexpected( uniqueInImages.error( ) );
+            }
+            if( uniqueInImages.value( ) ) {
+                // Remove wildcards at end for output
+                TrimSignature( signature );
+                return { };
+            }
+        }
+        currentAddress += instruction.length;
+
+        // Break if we leave function
+        if( !options.continueOutsideOfFunction && currentFunction != BAD_ADDRESS && database.GetFunctionStart( currentAddress ) != currentFunction ) {
+            return std::unexpected( "Signature left function scope" );
+        }
+    }
+    return std::unexpected( "Unknown" );
+}
+
+// Prefix of the trie, its bytes are its parent's followed by the appended ones
+// Only the appended bytes are kept, in one pool shared by all prefixes. Full signatures are built when they are searched or done
+struct PrefixBytes {
+    size_t parent = 0;
+    // Appended bytes in the pool
+    size_t offset = 0;
+    size_t size = 0;
+    // Bytes of the whole prefix
+    size_t length = 0;
+};
+
+struct PrefixTrie {
+    // The root is the empty prefix, it matches everywhere. Parents always come before their children
+    std::vector<PrefixBytes> prefixes = { PrefixBytes{ } };
+    Signature pool;
+    // Pool size after the last compaction
+    size_t compactedSize = 0;
+
+    std::span<const SignatureByte> Appended( size_t prefix ) const {
+        return std::span( pool ).subspan( prefixes[prefix].offset, prefixes[prefix].size );
+    }
+
+    void Build( size_t prefix, Signature& signature ) const {
+        // Fill in from the end, walking up to the root
+        signature.resize( prefixes[prefix].length );
+        for( auto end = signature.size( ); prefix != 0; prefix = prefixes[prefix].parent ) {
+            const auto appended = Appended( prefix );
+            end -= appended.size( );
+            std::ranges::copy( appended, signature.begin( ) + end );
+        }
+    }
+};
+
+static bool IsSameSignatureByte( const SignatureByte& a, const SignatureByte& b ) {
+    return a.value == b.value && a.isWildcard == b.isWildcard && a.mask == b.mask;
+}
+
+// Prefix shared by addresses whose signatures are equal so far, one per distinct prefix of the current growth step
+struct PrefixNode {
+    // Index into the prefix trie
+    size_t prefix = 0;
+    // Addresses the signature matches at, complete unless the search stopped at its limit
+    std::vector<uint64_t> candidates;
+    bool isComplete = false;
+    // Bytes following each candidate, for narrowing down the extensions
+    std::vector<uint8_t> following;
+    std::vector<size_t> followingSizes;
+    // Searched with a budget that ran out, so the candidates are incomplete
+    bool isOverBudget = false;
+    size_t parent = 0;
+    size_t appendedSize = 0;
+    // Time spent finding the candidates, charged to every address sharing the node
+    std::chrono::steady_clock::duration searchTime{ };
+    std::optional<std::expected<bool, std::string>> uniqueInImages;
+};
+
+// Matches kept per shared prefix to narrow down its extensions, prefixes with more are searched again once they grow
+static constexpr size_t MAX_PREFIX_CANDIDATES = 4096;
+
+// Hash of an extended prefix: the node it extends and the bytes appended to it. FNV-1a
+static uint64_t HashPrefixKey( size_t parent, std::span<const SignatureByte> appended ) {
+    uint64_t hash = 0xCBF29CE484222325ull ^ parent;
+    for( const auto& byte : appended ) {
+        hash = ( hash ^ byte.value ) * 0x100000001B3ull;
+        hash = ( hash ^ ( byte.isWildcard ? 0x100u : 0u ) ^ byte.mask ) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+// Whether enough of the pool may belong to prefixes that are no longer needed, i.e. it doubled since the last compaction
+static bool ShouldCompactPrefixTrie( const PrefixTrie& trie ) {
+    return trie.pool.size( ) >= 2 * std::max<size_t>( trie.compactedSize, 4096 );
+}
+
+// Keep only the prefixes of live nodes and their ancestors. Addresses that are done or split off leave their prefixes behind,
+// so without this memory would follow every signature ever grown rather than the ones still growing
+static void CompactPrefixTrie( PrefixTrie& trie, std::vector<PrefixNode>& nodes, const std::vector<uint8_t>& isLive ) {
+    // Children come after their parents, so walking backwards marks every ancestor of a kept prefix
+    std::vector<size_t> remap( trie.prefixes.size( ), 0 );
+    remap[0] = 1;
+    for( size_t n = 0; n < nodes.size( ); n++ ) {
+        if( isLive[n] ) {
+            remap[nodes[n].prefix] = 1;
+        }
+    }
+    for( size_t i = trie.prefixes.size( ); i-- > 1; ) {
+        if( remap[i] != 0 ) {
+            remap[trie.prefixes[i].parent] = 1;
+        }
+    }
+
+    std::vector<PrefixBytes> prefixes;
+    Signature pool;
+    for( size_t i = 0; i < trie.prefixes.size( ); i++ ) {
+        if( remap[i] == 0 ) {
+            continue;
+        }
+        auto prefix = trie.prefixes[i];
+        const auto appended = trie.Appended( i );
+        prefix.parent = i == 0 ? 0 : remap[prefix.parent];
+        prefix.offset = pool.size( );
+        pool.insert( pool.end( ), appended.begin( ), appended.end( ) );
+        remap[i] = prefixes.size( );
+        prefixes.push_back( prefix );
+    }
+    for( size_t n = 0; n < nodes.size( ); n++ ) {
+        nodes[n].prefix = isLive[n] ? remap[nodes[n].prefix] : 0;
+    }
+
+    trie.prefixes = std::move( prefixes );
+    trie.pool = std::move( pool );
+    trie.compactedSize = trie.pool.size( );
+}
+
+void GenerateUniqueSignaturesForEAs( const Database& database, std::span<const uint64_t> eas, const GeneratorOptions& options,
+                                     const std::function<void( size_t index, const std::expected<Signature, std::string>& result )>& onFinished ) {
+    // Growth state of one address, its signature is the one of its node
+    struct Growth {
+        size_t node = 0;
+        uint64_t currentAddress = 0;
+        uint64_t function = BAD_ADDRESS;
+        size_t sigPartLength = 0;
+        size_t instructionLength = 0;
+        std::chrono::steady_clock::duration elapsed{ };
+        bool isDone = false;
+    };
+
+    std::vector<Growth> growths( eas.size( ) );
+    size_t finished = 0;
+    auto finish = [&]( size_t index, const std::expected<Signature, std::string>& result ) {
+        growths[index].isDone = true;
+        finished++;
+        onFinished( index, result );
+    };
+
+    for( size_t i = 0; i < eas.size( ); i++ ) {
+        if( eas[i] == BAD_ADDRESS ) {
+            finish( i, std::unexpected( "Invalid address" ) );
+        }
+        else if( !database.IsCode( eas[i] ) ) {
+            finish( i, std::unexpected( "Can not create code signature for data" ) );
+        }
+        else {
+            growths[i].currentAddress = eas[i];
+            growths[i].function = database.GetFunctionStart( eas[i] );
+        }
+    }
+
+    const auto operandTypeBitmask = options.wildcardOperands ? options.operandTypeBitmask : 0;
+    const auto budget = std::chrono::milliseconds( options.timeBudgetMs );
+    CancelToken cancelToken( options.jobToken );
+    cancelToken.poll = options.isCancelled;
+
+    PrefixTrie trie;
+    std::vector<PrefixNode> nodes( 1 );
+    Signature signature;
+    // Reused by every step
+    std::vector<PrefixNode> children;
+    std::unordered_multimap<uint64_t, size_t> childIndices;
+    std::vector<std::chrono::steady_clock::duration> remainingBudgets;
+    std::vector<size_t> sharedBy, followingWidths;
+    std::vector<uint8_t> isLive;
+    size_t searches = 0, steps = 0;
+    while( finished < eas.size( ) ) {
+        // Handle "cancel" event, also checked inside the searches
+        if( cancelToken.IsCancelled( ) ) {
+            for( size_t i = 0; i < eas.size( ); i++ ) {
+                if( !growths[i].isDone ) {
+                    finish( i, std::unexpected( GetStopReason( cancelToken ) ) );
+                }
+            }
+            break;
+        }
+
+        // Extend every prefix by the next instruction of each address, addresses appending the same bytes stay together
+        children.clear( );
+        childIndices.clear( );
+        for( size_t i = 0; i < eas.size( ); i++ ) {
+            auto& growth = growths[i];
+            if( growth.isDone ) {
+                continue;
+            }
+            const auto& node = nodes[growth.node];
+
+            DecodedInstruction instruction;
+            if( !database.DecodeInstruction( growth.currentAddress, operandTypeBitmask, options.wildcardGranularity, instruction ) || instruction.length == 0 ) {
+                if( node.prefix == 0 ) {
+                    finish( i, std::unexpected( "Failed to decode first instruction" ) );
+                    continue;
+                }
+
+                trie.Build( node.prefix, signature );
+                Log( options, std::format( "Signature reached end of executable code @ {:X}\n", growth.currentAddress ) );
+                Log( options, std::format( "NOT UNIQUE Signature for {:X}: {}\n", eas[i], BuildIDASignatureString( signature ) ) );
+                finish( i, std::unexpected( "Signature not unique" ) );
+                continue;
+            }
+
+            // Length check in case the signature becomes too long
+            if( growth.sigPartLength > options.maxSignatureLength ) {
+                if( !options.askLongerSignature ) {
+                    finish( i, std::unexpected( "Signature exceeded maximum length" ) );
+                    continue;
+                }
+                auto result = options.askLongerSignature( trie.prefixes[node.prefix].length );
+                if( result == 1 ) { // Yes
+                    growth.sigPartLength = 0;
+                }
+                else if( result == 0 ) { // No
+                    trie.Build( node.prefix, signature );
+                    Log( options, std::format( "NOT UNIQUE Signature for {:X}: {}\n", eas[i], BuildIDASignatureString( signature ) ) );
+                    finish( i, std::unexpected( "Signature not unique" ) );
+                    continue;
+                }
+                else { // Cancel
+                    finish( i, std::unexpected( "Aborted" ) );
+                    continue;
+                }
+            }
+            growth.sigPartLength += instruction.length;
+            growth.instructionLength = instruction.length;
+            steps++;
+
+            // Append to the pool right away, the bytes are dropped again if an equal extension exists
+            const auto offset = trie.pool.size( );
+            AddInstructionToSignature( trie.pool, database, growth.currentAddress, instruction, options.wildcardGranularity );
+            const auto appended = std::span<const SignatureByte>( trie.pool ).subspan( offset );
+            const auto hash = HashPrefixKey( growth.node, appended );
+            auto [it, end] = childIndices.equal_range( hash );
+            it = std::find_if( it, end, [&]( const auto& entry ) {
+                const auto& child = children[entry.second];
+                return child.parent == growth.node && std::ranges::equal( trie.Appended( child.prefix ), appended, IsSameSignatureByte );
+            } );
+            if( it != end ) {
+                trie.pool.resize( offset );
+                growth.node = it->second;
+                continue;
+            }
+
+            PrefixNode extended;
+            extended.prefix = trie.prefixes.size( );
+            extended.parent = growth.node;
+            extended.appendedSize = appended.size( );
+            trie.prefixes.push_back( { node.prefix, offset, appended.size( ), trie.prefixes[node.prefix].length + appended.size( ) } );
+            growth.node = children.size( );
+            childIndices.emplace( hash, children.size( ) );
+            children.push_back( std::move( extended ) );
+        }
+
+        // Longest budget left among the addresses of each prefix, its search may not take longer than that
+        remainingBudgets.assign( children.size( ), std::chrono::steady_clock::duration::min( ) );
+        sharedBy.assign( children.size( ), 0 );
+        for( const auto& growth : growths ) {
+            if( !growth.isDone ) {
+                remainingBudgets[growth.node] = std::max( remainingBudgets[growth.node], budget - growth.elapsed );
+                sharedBy[growth.node]++;
+            }
+        }
+
+        // Bytes following each match of a complete prefix, read once for all of its extensions
+        followingWidths.assign( nodes.size( ), 0 );
+        for( const auto& child : children ) {
+            followingWidths[child.parent] = std::max( followingWidths[child.parent], child.appendedSize );
+        }
+        for( size_t n = 0; n < nodes.size( ); n++ ) {
+            auto& node = nodes[n];
+            if( !node.isComplete || followingWidths[n] == 0 ) {
+                continue;
+            }
+            node.following.assign( node.candidates.size( ) * followingWidths[n], 0 );
+            node.followingSizes.resize( node.candidates.size( ) );
+            for( size_t k = 0; k < node.candidates.size( ); k++ ) {
+                node.followingSizes[k] = database.ReadBytes( node.candidates[k] + trie.prefixes[node.prefix].length, &node.following[k * followingWidths[n]], followingWidths[n] );
+            }
+        }
+
+        // Matches of an extension are matches of its prefix, so a complete candidate list only has to be narrowed down
+        for( size_t c = 0; c < children.size( ); c++ ) {
+            auto& child = children[c];
+            const auto& parent = nodes[child.parent];
+            const auto searchStart = std::chrono::steady_clock::now( );
+            if( parent.isComplete ) {
+                const auto appended = trie.Appended( child.prefix );
+                const auto width = followingWidths[child.parent];
+                for( size_t k = 0; k < parent.candidates.size( ); k++ ) {
+                    if( parent.followingSizes[k] >= appended.size( ) && std::ranges::equal( std::span( parent.following ).subspan( k * width, appended.size( ) ), appended, MatchesSignatureByte ) ) {
+                        child.candidates.push_back( parent.candidates[k] );
+                    }
+                }
+                child.isComplete = true;
+            }
+            else {
+                CancelToken searchToken( &cancelToken );
+                if( budget.count( ) > 0 ) {
+                    searchToken.SetDeadline( searchStart + remainingBudgets[c] );
+                }
+                // Only shared prefixes collect their matches for narrowing down, for a single address the search can stop at the second match
+                const auto limit = sharedBy[c] > 1 ? MAX_PREFIX_CANDIDATES + 1 : 2;
+                trie.Build( child.prefix, signature );
+                child.candidates = database.FindOccurences( signature, limit, &searchToken );
+                child.isComplete = child.candidates.size( ) < limit;
+                child.isOverBudget = searchToken.IsCancelled( ) && !cancelToken.IsCancelled( );
+                searches++;
+            }
+            child.searchTime = std::chrono::steady_clock::now( ) - searchStart;
+        }
+        std::swap( nodes, children );
+
+        // Searches cut short by cancellation are incomplete, the check above ends generation
+        if( cancelToken.IsCancelled( ) ) {
+            continue;
+        }
+
+        for( size_t i = 0; i < eas.size( ); i++ ) {
+            auto& growth = growths[i];
+            if( growth.isDone ) {
+                continue;
+            }
+            auto& node = nodes[growth.node];
+
+            // A search cut short by the budget is incomplete, one that finished still counts
+            growth.elapsed += node.searchTime;
+            const bool isOverBudget = node.isOverBudget || ( budget.count( ) > 0 && growth.elapsed >= budget );
+            if( node.isOverBudget ) {
+                trie.Build( node.prefix, signature );
+                Log( options, std::format( "NOT UNIQUE Signature for {:X} when the time ran out: {}\n", eas[i], BuildIDASignatureString( signature ) ) );
+                finish( i, std::unexpected( "Time budget exceeded" ) );
+                continue;
+            }
+
+            if( node.isComplete && node.candidates.size( ) == 1 ) {
+                trie.Build( node.prefix, signature );
+                if( !node.uniqueInImages.has_value( ) ) {
+                    node.uniqueInImages = IsUniqueInExternalImages( signature );
+                }
+                if( !node.uniqueInImages->has_value( ) ) {
+                    finish( i, std::unexpected( node.uniqueInImages->error( ) ) );
+                    continue;
+                }
+                if( node.uniqueInImages->value( ) ) {
+                    // Remove wildcards at end for output
+                    TrimSignature( signature );
+                    finish( i, signature );
+                    continue;
+                }
+            }
+            growth.currentAddress += growth.instructionLength;
+
+            // Break if we leave function
+            if( !options.continueOutsideOfFunction && growth.function != BAD_ADDRESS && database.GetFunctionStart( growth.currentAddress ) != growth.function ) {
+                finish( i, std::unexpected( "Signature left function scope" ) );
+            }
+            else if( isOverBudget ) {
+                // Best we got within the budget
+                trie.Build( node.prefix, signature );
+                Log( options, std::format( "NOT UNIQUE Signature for {:X} when the time ran out: {}\n", eas[i], BuildIDASignatureString( signature ) ) );
+                finish( i, std::unexpected( "Time budget exceeded" ) );
+            }
+        }
+
+        if( ShouldCompactPrefixTrie( trie ) ) {
+            isLive.assign( nodes.size( ), 0 );
+            for( const auto& growth : growths ) {
+                if( !growth.isDone ) {
+                    isLive[growth.node] = 1;
+                }
+            }
+            CompactPrefixTrie( trie, nodes, isLive );
+        }
+
+        if( options.progress ) {
+            options.progress( finished, eas.size( ) );
+        }
+    }
+
+    Log( options, std::format( "{} signatures grown in {} steps with {} searches\n", eas.size( ), steps, searches ) );
+}
+
+std::expected<TargetSignature, std::string> GenerateUniqueSignatureAroundEA( const Database& database, uint64_t ea, const GeneratorOptions& options ) {
+    // Matches counted per candidate extension, more than this are considered equally bad
+    constexpr size_t MAX_COUNTED_MATCHES = 256;
+
+    if( ea == BAD_ADDRESS ) {
+        return std::unexpected( "Invalid address" );
+    }
+
+    if( !database.IsCode( ea ) ) {
+        return std::unexpected( "Can not create code signature for data" );
+    }
+
+    const auto operandTypeBitmask = options.wildcardOperands ? options.operandTypeBitmask : 0;
+    const auto currentFunction = database.GetFunctionStart( ea );
+    auto isInScope = [&]( uint64_t address ) {
+        return options.continueOutsideOfFunction || currentFunction == BAD_ADDRESS || database.GetFunctionStart( address ) == currentFunction;
+    };
+
+    // The target instruction is always part of the signature
+    DecodedInstruction instruction;
+    if( !database.DecodeInstruction( ea, operandTypeBitmask, options.wildcardGranularity, instruction ) || instruction.length == 0 ) {
+        return std::unexpected( "Failed to decode first instruction" );
+    }
+
+    Signature signature;
+    AddInstructionToSignature( signature, database, ea, instruction, options.wildcardGranularity );
+    auto startAddress = ea;
+    auto endAddress = ea + instruction.length;
+    size_t sigPartLength = instruction.length;
+    CancelToken cancelToken( options.jobToken );
+    ConfigureCancelToken( cancelToken, options );
+    auto matchCount = database.FindOccurences( signature, MAX_COUNTED_MATCHES, &cancelToken ).size( );
+
+    while( true ) {
+        // Handle "cancel" event, also checked inside the searches. Match counts of a cancelled search are incomplete
+        if( cancelToken.IsCancelled( ) ) {
+            if( cancelToken.IsPastDeadline( ) ) {
+                Log( options, std::format( "NOT UNIQUE Signature for {:X} when the time ran out: {}\n", ea, BuildIDASignatureString( signature ) ) );
+            }
+            return std::unexpected( GetStopReason( cancelToken ) );
+        }
+
+        if( matchCount == 1 ) {
+            const auto uniqueInImages = IsUniqueInExternalImages( signature );
+            if( !uniqueInImages.has_value( ) ) {
+                return std::unexpected( uniqueInImages.error( ) );
+            }
+            if( uniqueInImages.value( ) ) {
+                // Remove wildcards at both ends for output, but keep the target byte even if it is a wildcard
+                const auto targetOffset = static_cast<size_t>( ea - startAddress );
+                TrimSignature( signature );
+                if( signature.size( ) <= targetOffset ) {
+                    signature.resize( targetOffset + 1, SignatureByte{ 0, true } );
+                }
+                const auto leadingWildcards = std::min<size_t>( std::ranges::find_if( signature, []( const auto& sb ) { return !sb.isWildcard; } ) - signature.begin( ), targetOffset );
+                signature.erase( signature.begin( ), signature.begin( ) + leadingWildcards );
+
+                return TargetSignature{ signature, targetOffset - leadingWildcards };
+            }
+        }
+
+        // Length check in case the signature becomes too long
+        if( sigPartLength > options.maxSignatureLength ) {
+            if( options.askLongerSignature ) {
+                auto result = options.askLongerSignature( signature.size( ) );
+                if( result == 1 ) { // Yes
+                    sigPartLength = 0;
+                }
+                else if( result == 0 ) { // No
+                    Log( options, std::format( "NOT UNIQUE Signature for {:X}: {}\n", ea, BuildIDASignatureString( signature ) ) );
+                    return std::unexpected( "Signature not unique" );
+                }
+                else { // Cancel
+                    return std::unexpected( "Aborted" );
+                }
+            }
+            else {
+                return std::unexpected( "Signature exceeded maximum length" );
+            }
+        }
+
+        // Candidate extensions by one instruction in each direction
+        Signature forward, backward;
+        DecodedInstruction forwardInstruction, backwardInstruction;
+        const bool canGrowForward = isInScope( endAddress ) && database.DecodeInstruction( endAddress, operandTypeBitmask, options.wildcardGranularity, forwardInstruction ) && forwardInstruction.length > 0;
+        if( canGrowForward ) {
+            forward = signature;
+            AddInstructionToSignature( forward, database, endAddress, forwardInstruction, options.wildcardGranularity );
+        }
+
+        const auto previousAddress = database.GetPreviousInstruction( startAddress );
+        const bool canGrowBackward = previousAddress != BAD_ADDRESS && isInScope( previousAddress ) && database.DecodeInstruction( previousAddress, operandTypeBitmask, options.wildcardGranularity, backwardInstruction ) && backwardInstruction.length > 0;
+        if( canGrowBackward ) {
+            AddInstructionToSignature( backward, database, previousAddress, backwardInstruction, options.wildcardGranularity );
+            backward.insert( backward.end( ), signature.begin( ), signature.end( ) );
+        }
+
+        if( !canGrowForward && !canGrowBackward ) {
+            Log( options, std::format( "Signature reached end of executable code or function in both directions @ {:X}-{:X}\n", startAddress, endAddress ) );
+            Log( options, std::format( "NOT UNIQUE Signature for {:X}: {}\n", ea, BuildIDASignatureString( signature ) ) );
+            return std::unexpected( "Signature not unique" );
+        }
+
+        // Keep the direction that leaves fewer matches, forward on a tie
+        const auto forwardCount = canGrowForward ? database.FindOccurences( forward, std::min( matchCount, MAX_COUNTED_MATCHES ), &cancelToken ).size( ) : std::numeric_limits<size_t>::max( );
+        const auto backwardCount = canGrowBackward ? database.FindOccurences( backward, std::min( matchCount, MAX_COUNTED_MATCHES ), &cancelToken ).size( ) : std::numeric_limits<size_t>::max( );
+        if( forwardCount <= backwardCount ) {
+            signature = std::move( forward );
+            endAddress += forwardInstruction.length;
+            sigPartLength += forwardInstruction.length;
+            matchCount = forwardCount;
+        }
+        else {
+            signature = std::move( backward );
+            startAddress = previousAddress;
+            sigPartLength += backwardInstruction.length;
+            matchCount = backwardCount;
+        }
+    }
+    return std::unexpected( "Unknown" );
+}
+
+std::expected<Signature, std::string> GenerateSignatureForEARange( const Database& database, uint64_t eaStart, uint64_t eaEnd, const GeneratorOptions& options ) {
+    if( eaStart == BAD_ADDRESS || eaEnd == BAD_ADDRESS ) {
+        return std::unexpected( "Invalid address" );
+    }
+
+    Signature signature;
+
+    // Copy data section, no wildcards
+    if( !database.IsCode( eaStart ) ) {
+        AddBytesToSignature( signature, database, eaStart, eaEnd - eaStart, false );
+        return signature;
+    }
+
+    const auto operandTypeBitmask = options.wildcardOperands ? options.operandTypeBitmask : 0;
+    CancelToken cancelToken( options.jobToken );
+    ConfigureCancelToken( cancelToken, options );
+
+    auto currentAddress = eaStart;
+    while( true ) {
+        // Handle "cancel" event
+        if( cancelToken.IsCancelled( ) ) {
+            return std::unexpected( GetStopReason( cancelToken ) );
+        }
+
+        DecodedInstruction instruction;
+        if( !database.DecodeInstruction( currentAddress, operandTypeBitmask, options.wildcardGranularity, instruction ) || instruction.length == 0 ) {
+            if( signature.empty( ) ) {
+                return std::unexpected( "Failed to decode first instruction" );
+            }
+
+            Log( options, std::format( "Signature reached end of executable code @ {:X}\n", currentAddress ) );
+            // If we have some bytes left, add them
+            if( currentAddress < eaEnd ) {
+                AddBytesToSignature( signature, database, currentAddress, eaEnd - currentAddress, false );
+            }
+            TrimSignature( signature );
+            return signature;
+        }
+
+        AddInstructionToSignature( signature, database, currentAddress, instruction, options.wildcardGranularity );
+        currentAddress += instruction.length;
+
+        if( currentAddress >= eaEnd ) {
+            TrimSignature( signature );
+            return signature;
+        }
+    }
+    return std::unexpected( "Unknown" );
+}
+
+ShortestSignatures::ShortestSignatures( size_t capacity ) : capacity( capacity ) {
+    slots.reserve( capacity );
+    heap.reserve( capacity );
+}
+
+bool ShortestSignatures::IsLonger( size_t a, size_t b ) const {
+    // Equally long signatures keep the order they were offered in
+    const auto& slotA = slots[a];
+    const auto& slotB = slots[b];
+    return slotA.signature.size( ) != slotB.signature.size( ) ? slotA.signature.size( ) > slotB.signature.size( ) : slotA.order > slotB.order;
+}
+
+bool ShortestSignatures::Offer( uint64_t ea, const Signature& signature ) {
+    const auto order = offered++;
+    if( capacity == 0 ) {
+        return false;
+    }
+
+    // Max-heap on length, the root is the longest signature kept
+    const auto longerFirst = [this]( size_t a, size_t b ) { return IsLonger( b, a ); };
+    if( slots.size( ) < capacity ) {
+        slots.push_back( { ea, order, signature } );
+        heap.push_back( slots.size( ) - 1 );
+        std::ranges::push_heap( heap, longerFirst );
+        return true;
+    }
+
+    auto& longest = slots[heap.front( )];
+    if( signature.size( ) >= longest.signature.size( ) ) {
+        return false;
+    }
+
+    // Replace the longest one in place, assign keeps the slot's capacity
+    std::ranges::pop_heap( heap, longerFirst );
+    longest.ea = ea;
+    longest.order = order;
+    longest.signature.assign( signature.begin( ), signature.end( ) );
+    std::ranges::push_heap( heap, longerFirst );
+    return true;
+}
+
+std::vector<const ShortestSignatures::Entry*> ShortestSignatures::Sorted( ) const {
+    std::vector<size_t> indices( heap );
+    std::ranges::sort( indices, [this]( size_t a, size_t b ) { return IsLonger( b, a ); } );
+
+    std::vector<const Entry*> entries;
+    entries.reserve( indices.size( ) );
+    for( const auto index : indices ) {
+        entries.push_back( &slots[index] );
+    }
+    return entries;
+}
+
+size_t ShortestSignatures::OfferedCount( ) const {
+    return offered;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "Database.h"
+#include <expected>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+
+struct GeneratorOptions {
+    bool wildcardOperands = true;
+    bool continueOutsideOfFunction = false;
+    uint32_t operandTypeBitmask = 0;
+    size_t maxSignatureLength = 1000;
+    // Partial wildcards for register fields, if the decoder knows them. Byte keeps whole-byte wildcards only
+    WildcardGranularity wildcardGranularity = WildcardGranularity::Byte;
+
+    // Asked when maxSignatureLength is reached: 1 to continue, 0 to stop, -1 to abort. Stops if not set
+    std::function<int( size_t signatureLength )> askLongerSignature;
+    // Polled between instructions and by the scan kernels, at most every CancelToken::POLL_INTERVAL
+    std::function<bool( )> isCancelled;
+    // Wall-clock budget per address in milliseconds, 0 for none. When it runs out, the best signature so far is logged and generation stops
+    size_t timeBudgetMs = 0;
+    // Cancels the whole job, e.g. the total deadline of xref and batch generation. Not owned
+    const CancelToken* jobToken = nullptr;
+    // Bulk generation only: called after every growth step with the amount of addresses that are done
+    std::function<void( size_t finished, size_t total )> progress;
+    // Receives diagnostic messages
+    std::function<void( std::string_view message )> log;
+};
+
+// Signature that does not have to start at its target
+struct TargetSignature {
+    Signature signature;
+    // Offset of the target address from the start of a match
+    size_t targetOffset = 0;
+};
+
+// Grow a signature instruction by instruction until it is unique
+std::expected<Signature, std::string> GenerateUniqueSignatureForEA( const Database& database, uint64_t ea, const GeneratorOptions& options );
+// Same, but grows the caller's signature, so bulk generation can reuse one scratch signature for every address
+std::expected<void, std::string> GenerateUniqueSignatureForEA( const Database& database, uint64_t ea, const GeneratorOptions& options, Signature& signature );
+
+// Same for many addresses at once, e.g. all xrefs to a global. Addresses whose instructions start alike share a node of a prefix trie,
+// every distinct prefix is searched once and its matches are narrowed down by comparing bytes instead of searching again
+// Each result is handed to onFinished with its index into `eas` as soon as it is done, and is the same as generating the signature on its own
+// timeBudgetMs counts the searches of shared prefixes for every address sharing them
+void GenerateUniqueSignaturesForEAs( const Database& database, std::span<const uint64_t> eas, const GeneratorOptions& options,
+                                     const std::function<void( size_t index, const std::expected<Signature, std::string>& result )>& onFinished );
+
+// Grow a signature forwards and backwards from the address, in whichever direction leaves fewer matches
+std::expected<TargetSignature, std::string> GenerateUniqueSignatureAroundEA( const Database& database, uint64_t ea, const GeneratorOptions& options );
+
+// Signature for a fixed range, e.g. a code selection
+std::expected<Signature, std::string> GenerateSignatureForEARange( const Database& database, uint64_t eaStart, uint64_t eaEnd, const GeneratorOptions& options );
+
+// The `capacity` shortest signatures of a bulk job, e.g. xref signatures of which only the top few are printed
+// Kept signatures live in a fixed pool of slots that is overwritten in place, so memory stays flat however many are offered
+class ShortestSignatures {
+public:
+    struct Entry {
+        uint64_t ea;
+        size_t order;
+        Signature signature;
+    };
+
+    explicit ShortestSignatures( size_t capacity );
+
+    // Returns true if the signature is among the shortest so far and was copied
+    bool Offer( uint64_t ea, const Signature& signature );
+    // Kept signatures, shortest first, equally long ones in the order they were offered
+    std::vector<const Entry*> Sorted( ) const;
+    // Every signature offered, kept or not
+    size_t OfferedCount( ) const;
+
+private:
+    bool IsLonger( size_t a, size_t b ) const;
+
+    size_t capacity;
+    size_t offered = 0;
+    std::vector<Entry> slots;
+    // Indices into slots, longest on top
+    std::vector<size_t> heap;
+};
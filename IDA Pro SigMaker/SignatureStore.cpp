@@ -0,0 +1,224 @@
+#include "SignatureStore.h"
+#include "ExternalImages.h"
+#include "Plugin.h"
+#include <netnode.hpp>
+#include <algorithm>
+#include <cstring>
+
+// All entries are kept in one blob, blobs span consecutive indexes so they can't be keyed by address
+static constexpr char STORE_NODE_NAME[] = "$ SigMaker signatures";
+static constexpr uchar STORE_BLOB_TAG = 'S';
+static constexpr uint32_t STORE_VERSION = 2;
+
+template <typename T>
+static void Append( std::vector<uint8_t>& blob, T value ) {
+    const auto offset = blob.size( );
+    blob.resize( offset + sizeof( T ) );
+    std::memcpy( blob.data( ) + offset, &value, sizeof( T ) );
+}
+
+template <typename T>
+static bool Extract( const std::vector<uint8_t>& blob, size_t& offset, T& value ) {
+    if( offset + sizeof( T ) > blob.size( ) ) {
+        return false;
+    }
+    std::memcpy( &value, blob.data( ) + offset, sizeof( T ) );
+    offset += sizeof( T );
+    return true;
+}
+
+// FNV-1a
+static uint64_t HashBytes( const uint8_t* bytes, size_t size ) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for( size_t i = 0; i < size; i++ ) {
+        hash = ( hash ^ bytes[i] ) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+uint64_t HashExternalImagePathList( std::string_view pathList ) {
+    return pathList.empty( ) ? 0 : HashBytes( reinterpret_cast<const uint8_t*>( pathList.data( ) ), pathList.size( ) );
+}
+
+uint64_t SignatureStore::HashCoveredBytes( uint64_t ea, const StoredSignature& entry ) const {
+    std::vector<uint8_t> bytes( entry.signature.size( ) );
+    if( database.ReadBytes( ea - entry.targetOffset, bytes.data( ), bytes.size( ) ) != bytes.size( ) ) {
+        return 0;
+    }
+    return HashBytes( bytes.data( ), bytes.size( ) );
+}
+
+void SignatureStore::Load( ) {
+    if( isLoaded ) {
+        return;
+    }
+    isLoaded = true;
+    entries.clear( );
+
+    netnode node( STORE_NODE_NAME );
+    if( node == BADNODE ) {
+        return;
+    }
+    size_t blobSize = node.blobsize( 0, STORE_BLOB_TAG );
+    std::vector<uint8_t> blob( blobSize );
+    if( blobSize == 0 || node.getblob( blob.data( ), &blobSize, 0, STORE_BLOB_TAG ) == nullptr ) {
+        return;
+    }
+    blob.resize( blobSize );
+
+    size_t offset = 0;
+    uint32_t version = 0, count = 0;
+    if( !Extract( blob, offset, version ) || version != STORE_VERSION || !Extract( blob, offset, count ) ) {
+        msg( "Ignoring stored signatures of an unknown version\n" );
+        return;
+    }
+
+    for( uint32_t i = 0; i < count; i++ ) {
+        uint64_t ea = 0;
+        uint32_t targetOffset = 0, length = 0;
+        uint8_t isStale = 0;
+        StoredSignature entry;
+        if( !Extract( blob, offset, ea ) || !Extract( blob, offset, entry.options.flags ) || !Extract( blob, offset, entry.options.operandTypeBitmask ) ||
+            !Extract( blob, offset, entry.options.wildcardGranularity ) || !Extract( blob, offset, entry.options.maxSignatureLength ) ||
+            !Extract( blob, offset, entry.options.externalImagesHash ) || !Extract( blob, offset, targetOffset ) || !Extract( blob, offset, entry.coveredBytesHash ) ||
+            !Extract( blob, offset, isStale ) || !Extract( blob, offset, length ) ) {
+            break;
+        }
+        entry.targetOffset = targetOffset;
+        entry.isStale = isStale != 0;
+
+        entry.signature.resize( length );
+        bool isComplete = true;
+        for( auto& byte : entry.signature ) {
+            uint8_t isWildcard = 0;
+            isComplete = Extract( blob, offset, byte.value ) && Extract( blob, offset, isWildcard ) && Extract( blob, offset, byte.mask );
+            if( !isComplete ) {
+                break;
+            }
+            byte.isWildcard = isWildcard != 0;
+        }
+        if( !isComplete ) {
+            break;
+        }
+        entries[ea] = std::move( entry );
+    }
+}
+
+void SignatureStore::Save( ) const {
+    if( entries.empty( ) ) {
+        netnode node( STORE_NODE_NAME );
+        if( node != BADNODE ) {
+            node.delblob( 0, STORE_BLOB_TAG );
+        }
+        return;
+    }
+    netnode node( STORE_NODE_NAME, 0, true );
+
+    std::vector<uint8_t> blob;
+    Append( blob, STORE_VERSION );
+    Append( blob, static_cast<uint32_t>( entries.size( ) ) );
+    for( const auto& [ea, entry] : entries ) {
+        Append( blob, ea );
+        Append( blob, entry.options.flags );
+        Append( blob, entry.options.operandTypeBitmask );
+        Append( blob, entry.options.wildcardGranularity );
+        Append( blob, entry.options.maxSignatureLength );
+        Append( blob, entry.options.externalImagesHash );
+        Append( blob, static_cast<uint32_t>( entry.targetOffset ) );
+        Append( blob, entry.coveredBytesHash );
+        Append( blob, static_cast<uint8_t>( entry.isStale ) );
+        Append( blob, static_cast<uint32_t>( entry.signature.size( ) ) );
+        for( const auto& byte : entry.signature ) {
+            Append( blob, byte.value );
+            Append( blob, static_cast<uint8_t>( byte.isWildcard ) );
+            Append( blob, byte.mask );
+        }
+    }
+    node.setblob( blob.data( ), blob.size( ), 0, STORE_BLOB_TAG );
+}
+
+std::optional<StoredSignature> SignatureStore::Find( uint64_t ea, const StoredSignatureOptions& options ) {
+    Load( );
+    const auto it = entries.find( ea );
+    if( it == entries.end( ) || it->second.options != options || it->second.isStale ) {
+        return std::nullopt;
+    }
+
+    // Bytes that were patched since the recheck ran
+    if( HashCoveredBytes( ea, it->second ) != it->second.coveredBytesHash ) {
+        it->second.isStale = true;
+        Save( );
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void SignatureStore::Store( uint64_t ea, const StoredSignatureOptions& options, const Signature& signature, size_t targetOffset ) {
+    Load( );
+    StoredSignature entry;
+    entry.options = options;
+    entry.signature = signature;
+    entry.targetOffset = targetOffset;
+    entry.coveredBytesHash = HashCoveredBytes( ea, entry );
+    entries[ea] = std::move( entry );
+    Save( );
+}
+
+void SignatureStore::Clear( ) {
+    entries.clear( );
+    pendingRecheck.clear( );
+    isLoaded = true;
+    Save( );
+}
+
+const std::map<uint64_t, StoredSignature>& SignatureStore::GetEntries( ) {
+    Load( );
+    return entries;
+}
+
+void SignatureStore::ScheduleRecheck( ) {
+    Load( );
+    pendingRecheck.clear( );
+    for( const auto& [ea, entry] : entries ) {
+        if( !entry.isStale ) {
+            pendingRecheck.push_back( ea );
+        }
+    }
+}
+
+bool SignatureStore::RecheckNext( ) {
+    if( pendingRecheck.empty( ) ) {
+        return false;
+    }
+    const auto ea = pendingRecheck.back( );
+    pendingRecheck.pop_back( );
+
+    const auto it = entries.find( ea );
+    if( it != entries.end( ) && !it->second.isStale ) {
+        auto& entry = it->second;
+        if( HashCoveredBytes( ea, entry ) != entry.coveredBytesHash ) {
+            entry.isStale = true;
+            msg( "Stored signature for %I64X is stale: its bytes changed\n", ea );
+        }
+        else if( const auto matches = database.FindOccurences( entry.signature, 2 ); matches.size( ) != 1 || matches[0] != ea - entry.targetOffset ) {
+            entry.isStale = true;
+            msg( "Stored signature for %I64X is stale: it is no longer unique\n", ea );
+        }
+        else if( entry.options.externalImagesHash != 0 && entry.options.externalImagesHash == HashExternalImagePathList( GetExternalImagePathList( ) ) &&
+                 !std::ranges::all_of( CountSignatureOccurencesInImages( entry.signature, 2 ), []( size_t count ) { return count == 1; } ) ) {
+            // Entries of other image lists are never answered, only the current images can be checked
+            entry.isStale = true;
+            msg( "Stored signature for %I64X is stale: it is no longer unique in the external images\n", ea );
+        }
+        if( entry.isStale ) {
+            Save( );
+        }
+    }
+    return !pendingRecheck.empty( );
+}
+
+void SignatureStore::Unload( ) {
+    entries.clear( );
+    pendingRecheck.clear( );
+    isLoaded = false;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "Database.h"
+#include <compare>
+#include <map>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// Settings a stored signature was generated with, a request with different settings generates a new one
+struct StoredSignatureOptions {
+    uint32_t flags = 0; // StoredSignatureFlags
+    uint32_t operandTypeBitmask = 0;
+    uint32_t wildcardGranularity = 0;
+    // A longer limit may find a signature where a shorter one gave up
+    uint32_t maxSignatureLength = 0;
+    // HashExternalImagePathList of the images the signature is unique in as well
+    uint64_t externalImagesHash = 0;
+
+    auto operator<=>( const StoredSignatureOptions& ) const = default;
+};
+
+enum StoredSignatureFlags : uint32_t {
+    StoredWildcardOperands = 1 << 0,
+    StoredContinueOutsideOfFunction = 1 << 1,
+    StoredWildcardOptimizedInstruction = 1 << 2,
+    StoredGrowBackwards = 1 << 3,
+};
+
+// Stable across sessions, unlike std::hash
+uint64_t HashExternalImagePathList( std::string_view pathList );
+
+struct StoredSignature {
+    StoredSignatureOptions options;
+    Signature signature;
+    size_t targetOffset = 0;
+    // FNV-1a of the bytes the signature covers, to notice patches
+    uint64_t coveredBytesHash = 0;
+    // Set by the recheck when the bytes changed or the signature is no longer unique
+    bool isStale = false;
+};
+
+// Signatures generated for the current IDB, persisted in a netnode so repeated requests are answered instantly
+class SignatureStore {
+public:
+    explicit SignatureStore( const Database& database ) : database( database ) {
+    }
+
+    // Stored signature for the address, if it was generated with the same options and the covered bytes did not change
+    std::optional<StoredSignature> Find( uint64_t ea, const StoredSignatureOptions& options );
+    void Store( uint64_t ea, const StoredSignatureOptions& options, const Signature& signature, size_t targetOffset );
+    void Clear( );
+    const std::map<uint64_t, StoredSignature>& GetEntries( );
+
+    // Queue every entry for a recheck, e.g. after bytes were patched or segments were added
+    void ScheduleRecheck( );
+    // Recheck one queued entry, returns false once the queue is empty
+    bool RecheckNext( );
+
+    // Forget the in-memory copy, called when the IDB is closed
+    void Unload( );
+
+private:
+    void Load( );
+    void Save( ) const;
+    uint64_t HashCoveredBytes( uint64_t ea, const StoredSignature& entry ) const;
+
+    const Database& database;
+    std::map<uint64_t, StoredSignature> entries;
+    std::vector<uint64_t> pendingRecheck;
+    bool isLoaded = false;
+};
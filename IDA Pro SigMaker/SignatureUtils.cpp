@@ -1,87 +1,327 @@
 #include "SignatureUtils.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <iterator>
 
-std::string BuildIDASignatureString( const Signature& signature, bool doubleQM ) {
-    std::ostringstream result;
-    // Build hex pattern
-    for( const auto& byte : signature ) {
-        if( byte.isWildcard ) {
-            result << ( doubleQM ? "??" : "?" );
+// Two hex digits per byte value
+static constexpr auto HEX_TABLE = [] {
+    constexpr char hexDigits[] = "0123456789ABCDEF";
+    std::array<std::array<char, 2>, 256> table{ };
+    for( size_t i = 0; i < table.size( ); i++ ) {
+        table[i] = { hexDigits[i >> 4], hexDigits[i & 0x0F] };
+    }
+    return table;
+}( );
+
+// Writes into the caller's buffer while it has room, and counts the full length
+class FormatWriter {
+public:
+    FormatWriter( char* buffer, size_t bufferSize ) : buffer( buffer ), bufferSize( bufferSize ) {
+    }
+
+    void Put( char c ) {
+        if( length < bufferSize ) {
+            buffer[length] = c;
         }
-        else {
-            result << std::format( "{:02X}", byte.value );
+        length++;
+    }
+    void Put( std::string_view str ) {
+        for( const auto c : str ) {
+            Put( c );
         }
-        result << " ";
     }
-    auto str = result.str( );
-    // Remove whitespace at end
-    if( !str.empty( ) ) {
-        str.pop_back( );
+    void PutHex( uint8_t value ) {
+        Put( HEX_TABLE[value][0] );
+        Put( HEX_TABLE[value][1] );
+    }
+    // Without leading zeros, like "{:X}"
+    void PutAddress( uint64_t value ) {
+        int shift = 60;
+        while( shift > 0 && ( value >> shift ) == 0 ) {
+            shift -= 4;
+        }
+        for( ; shift >= 0; shift -= 4 ) {
+            Put( HEX_TABLE[( value >> shift ) & 0x0F][1] );
+        }
+    }
+    void PutDecimal( size_t value ) {
+        char digits[20];
+        const auto result = std::to_chars( std::begin( digits ), std::end( digits ), value );
+        Put( std::string_view( digits, result.ptr - digits ) );
+    }
+
+    size_t Length( ) const {
+        return length;
+    }
+
+private:
+    char* buffer;
+    size_t bufferSize;
+    size_t length = 0;
+};
+
+static void WriteIDASignature( FormatWriter& out, const Signature& signature, bool doubleQM, size_t targetOffset ) {
+    for( size_t i = 0; i < signature.size( ); i++ ) {
+        const auto& byte = signature[i];
+        if( i != 0 ) {
+            out.Put( ' ' );
+        }
+        // Bracket the target byte, brackets are ignored when searching
+        const auto isTarget = targetOffset != 0 && i == targetOffset;
+        if( isTarget ) {
+            out.Put( '[' );
+        }
+
+        if( byte.isWildcard || byte.mask == 0 ) {
+            out.Put( doubleQM ? "??" : "?" );
+        }
+        else if( IsPartialWildcard( byte ) ) {
+            // Nibble wildcards, a nibble with any free bit is printed as "?"
+            out.Put( ( byte.mask & 0xF0 ) == 0xF0 ? HEX_TABLE[byte.value][0] : '?' );
+            out.Put( ( byte.mask & 0x0F ) == 0x0F ? HEX_TABLE[byte.value][1] : '?' );
+        }
+        else {
+            out.PutHex( byte.value );
+        }
+
+        if( isTarget ) {
+            out.Put( ']' );
+        }
     }
-    return str;
 }
 
-std::string BuildByteArrayWithMaskSignatureString( const Signature& signature ) {
-    std::ostringstream pattern;
-    std::ostringstream mask;
-    // Build hex pattern
+static void WriteByteArrayWithMaskSignature( FormatWriter& out, const Signature& signature ) {
+    // The string mask has no partial wildcards, those bytes are wildcarded completely
     for( const auto& byte : signature ) {
-        pattern << "\\x" << std::format( "{:02X}", ( byte.isWildcard ? 0 : byte.value ) );
-        mask << ( byte.isWildcard ? "?" : "x" );
+        out.Put( "\\x" );
+        out.PutHex( byte.isWildcard || IsPartialWildcard( byte ) ? 0 : byte.value );
+    }
+    out.Put( ' ' );
+    for( const auto& byte : signature ) {
+        out.Put( byte.isWildcard || IsPartialWildcard( byte ) ? '?' : 'x' );
+    }
+}
+
+static void WriteBytesWithBitmaskSignature( FormatWriter& out, const Signature& signature ) {
+    // Partial wildcards need a full mask byte per signature byte
+    if( std::ranges::any_of( signature, IsPartialWildcard ) ) {
+        for( size_t i = 0; i < signature.size( ); i++ ) {
+            out.Put( i == 0 ? "0x" : ", 0x" );
+            out.PutHex( signature[i].value & GetMatchMask( signature[i] ) );
+        }
+        out.Put( ' ' );
+        for( size_t i = 0; i < signature.size( ); i++ ) {
+            out.Put( i == 0 ? " 0x" : ", 0x" );
+            out.PutHex( GetMatchMask( signature[i] ) );
+        }
+        return;
+    }
+
+    for( size_t i = 0; i < signature.size( ); i++ ) {
+        out.Put( i == 0 ? "0x" : ", 0x" );
+        out.PutHex( signature[i].isWildcard ? 0 : signature[i].value );
     }
-    auto str = pattern.str( ) + " " + mask.str( );
+    // Bitmask is reversed, the first byte is the lowest bit
+    out.Put( "  0b" );
+    for( auto it = signature.rbegin( ); it != signature.rend( ); ++it ) {
+        out.Put( it->isWildcard ? '0' : '1' );
+    }
+}
+
+static void WriteSignature( FormatWriter& out, const Signature& signature, SignatureType type, size_t targetOffset ) {
+    using enum SignatureType;
+    switch( type ) {
+    case IDA:
+    case x64Dbg:
+        WriteIDASignature( out, signature, type == x64Dbg, targetOffset < signature.size( ) ? targetOffset : 0 );
+        break;
+    case Signature_Mask:
+    case SignatureByteArray_Bitmask:
+        if( type == Signature_Mask ) {
+            WriteByteArrayWithMaskSignature( out, signature );
+        }
+        else {
+            WriteBytesWithBitmaskSignature( out, signature );
+        }
+        if( targetOffset != 0 ) {
+            out.Put( " // target offset " );
+            out.PutDecimal( targetOffset );
+        }
+        break;
+    case CppPattern:
+        // IDA style inside the literal, the header parses nibble wildcards and the target bracket as well
+        out.Put( "sigmaker::Pattern<\"" );
+        WriteIDASignature( out, signature, false, targetOffset < signature.size( ) ? targetOffset : 0 );
+        out.Put( "\">" );
+        break;
+    }
+}
+
+size_t FormatSignatureTo( char* buffer, size_t bufferSize, const Signature& signature, SignatureType type, size_t targetOffset ) {
+    FormatWriter out( buffer, bufferSize );
+    WriteSignature( out, signature, type, targetOffset );
+    return out.Length( );
+}
+
+std::string FormatSignature( const Signature& signature, SignatureType type, size_t targetOffset ) {
+    std::string str( FormatSignatureTo( nullptr, 0, signature, type, targetOffset ), '\0' );
+    FormatSignatureTo( str.data( ), str.size( ), signature, type, targetOffset );
     return str;
 }
 
+std::string BuildIDASignatureString( const Signature& signature, bool doubleQM ) {
+    return FormatSignature( signature, doubleQM ? SignatureType::x64Dbg : SignatureType::IDA );
+}
+
+std::string BuildByteArrayWithMaskSignatureString( const Signature& signature ) {
+    return FormatSignature( signature, SignatureType::Signature_Mask );
+}
+
 std::string BuildBytesWithBitmaskSignatureString( const Signature& signature ) {
-    std::ostringstream pattern;
-    std::ostringstream mask;
-    // Build hex pattern
-    for( const auto& byte : signature ) {
-        pattern << "0x" << std::format( "{:02X}", ( byte.isWildcard ? 0 : byte.value ) ) << ", ";
-        mask << ( byte.isWildcard ? "0" : "1" );
+    return FormatSignature( signature, SignatureType::SignatureByteArray_Bitmask );
+}
+
+SignatureFileWriter::~SignatureFileWriter( ) {
+    Close( );
+}
+
+bool SignatureFileWriter::Open( const std::string& path, size_t bufferSize ) {
+    Close( );
+    file.open( path, std::ios::binary | std::ios::trunc );
+    buffer.resize( bufferSize );
+    used = 0;
+    return file.is_open( );
+}
+
+bool SignatureFileWriter::Close( ) {
+    if( !file.is_open( ) ) {
+        return false;
     }
-    auto patternStr = pattern.str( );
-    auto maskStr = mask.str( );
+    Flush( );
+    file.close( );
+    return !file.fail( );
+}
+
+void SignatureFileWriter::Flush( ) {
+    file.write( buffer.data( ), static_cast<std::streamsize>( used ) );
+    used = 0;
+}
 
-    // Reverse bitmask
-    std::ranges::reverse( maskStr );
+void SignatureFileWriter::Write( uint64_t ea, const Signature& signature, SignatureType type, size_t targetOffset ) {
+    // Format straight into the free part of the buffer, flush and retry if the line didn't fit
+    auto formatLine = [&]( ) {
+        FormatWriter out( buffer.data( ) + used, buffer.size( ) - used );
+        out.PutAddress( ea );
+        out.Put( ": " );
+        WriteSignature( out, signature, type, targetOffset );
+        out.Put( '\n' );
+        return out.Length( );
+    };
 
-    // Remove separators
-    if( !patternStr.empty( ) ) {
-        patternStr.pop_back( );
-        patternStr.pop_back( );
+    auto length = formatLine( );
+    if( length > buffer.size( ) - used ) {
+        Flush( );
+        length = formatLine( );
+        if( length > buffer.size( ) ) {
+            // Longer than the whole buffer, only happens for huge signatures
+            buffer.resize( length );
+            length = formatLine( );
+        }
     }
+    used += length;
+}
 
-    auto str = patternStr + " " + " 0b" + maskStr;
-    return str;
+Signature ParseIDASignatureString( std::string_view signatureString ) {
+    Signature signature;
+    size_t position = 0;
+    while( position < signatureString.size( ) ) {
+        // Skip separators
+        if( std::isspace( static_cast<unsigned char>( signatureString[position] ) ) ) {
+            position++;
+            continue;
+        }
+
+        auto end = position;
+        while( end < signatureString.size( ) && !std::isspace( static_cast<unsigned char>( signatureString[end] ) ) ) {
+            end++;
+        }
+
+        const auto token = signatureString.substr( position, end - position );
+        if( token.size( ) == 2 && token != "??" && token.find( '?' ) != std::string_view::npos ) {
+            // Nibble wildcard like "8?" or "?B"
+            const auto nibble = static_cast<uint8_t>( std::stoi( std::string( 1, token[token[0] == '?' ? 1 : 0] ), nullptr, 16 ) );
+            SignatureByte byte{ static_cast<uint8_t>( token[0] == '?' ? nibble : nibble << 4 ), false };
+            byte.mask = token[0] == '?' ? 0x0F : 0xF0;
+            signature.push_back( byte );
+        }
+        else if( token.front( ) == '?' ) {
+            signature.push_back( { 0, true } );
+        }
+        else {
+            signature.push_back( { static_cast<uint8_t>( std::stoi( std::string( token ), nullptr, 16 ) ), false } );
+        }
+        position = end;
+    }
+    return signature;
 }
 
-std::string FormatSignature( const Signature& signature, SignatureType type ) {
+WildcardGranularity GetWildcardGranularity( SignatureType type ) {
     using enum SignatureType;
     switch( type ) {
     case IDA:
-        return BuildIDASignatureString( signature );
     case x64Dbg:
-        return BuildIDASignatureString( signature, true );
-    case Signature_Mask:
-        return BuildByteArrayWithMaskSignatureString( signature );
+    case CppPattern:
+        return WildcardGranularity::Nibble;
     case SignatureByteArray_Bitmask:
-        return BuildBytesWithBitmaskSignatureString( signature );
+        return WildcardGranularity::Bit;
+    default:
+        return WildcardGranularity::Byte;
+    }
+}
+
+void ApplyWildcardGranularity( SignatureByte& byte, WildcardGranularity granularity ) {
+    if( !IsPartialWildcard( byte ) ) {
+        return;
+    }
+
+    // Widen partial wildcards, so the signature matches at least what it matched before
+    if( granularity == WildcardGranularity::Byte ) {
+        byte.mask = 0;
+    }
+    else if( granularity == WildcardGranularity::Nibble ) {
+        byte.mask = ( ( byte.mask & 0xF0 ) == 0xF0 ? 0xF0 : 0 ) | ( ( byte.mask & 0x0F ) == 0x0F ? 0x0F : 0 );
+    }
+
+    if( byte.mask == 0 ) {
+        byte = { 0, true };
+    }
+    else {
+        byte.value &= byte.mask;
+    }
+}
+
+void ApplyWildcardGranularity( Signature& signature, WildcardGranularity granularity ) {
+    for( auto& byte : signature ) {
+        ApplyWildcardGranularity( byte, granularity );
     }
-    return {};
 }
 
-void AddByteToSignature( Signature& signature, ea_t address, bool wildcard ) {
-    SignatureByte byte{};
-    byte.isWildcard = wildcard;
-    byte.value = get_byte( address );
-    signature.push_back( byte );
+void AddByteToSignature( Signature& signature, const Database& database, uint64_t address, bool wildcard ) {
+    AddBytesToSignature( signature, database, address, 1, wildcard );
 }
 
-void AddBytesToSignature( Signature& signature, ea_t address, size_t count, bool wildcard ) {
-    // signature.reserve( signature.size() + count ); // Not sure if this is overhead for average signature creation
-    for( size_t i = 0; i < count; i++ ) {
-        AddByteToSignature( signature, address + i, wildcard );
+void AddBytesToSignature( Signature& signature, const Database& database, uint64_t address, size_t count, bool wildcard ) {
+    // Read through a small stack buffer, this runs for every instruction of every generated signature
+    uint8_t bytes[64];
+    for( size_t offset = 0; offset < count; offset += sizeof( bytes ) ) {
+        const auto size = std::min( count - offset, sizeof( bytes ) );
+        const auto bytesRead = database.ReadBytes( address + offset, bytes, size );
+        std::fill( bytes + std::min( bytesRead, size ), bytes + size, 0 );
+        for( size_t i = 0; i < size; i++ ) {
+            signature.push_back( { bytes[i], wildcard } );
+        }
     }
 }
 
@@ -1,13 +1,52 @@
 #pragma once
-#include "Main.h"
+#include "Signature.h"
+#include "Database.h"
+#include <fstream>
+#include <string>
+#include <string_view>
 
 // Output functions
 std::string BuildIDASignatureString( const Signature& signature, bool doubleQM = false );
 std::string BuildByteArrayWithMaskSignatureString( const Signature& signature );
 std::string BuildBytesWithBitmaskSignatureString( const Signature& signature );
-std::string FormatSignature( const Signature& signature, SignatureType type );
+// A non-zero target offset is marked in the output: "[E8]" for IDA and x64Dbg styles, a trailing comment for the C styles
+std::string FormatSignature( const Signature& signature, SignatureType type, size_t targetOffset = 0 );
+// Same output without allocating: writes at most bufferSize characters, without terminator, and returns the full length
+// Call again with a larger buffer if the returned length exceeds bufferSize
+size_t FormatSignatureTo( char* buffer, size_t bufferSize, const Signature& signature, SignatureType type, size_t targetOffset = 0 );
+
+// Bulk export, formats "<address>: <signature>" lines straight into a write buffer
+class SignatureFileWriter {
+public:
+    SignatureFileWriter( ) = default;
+    ~SignatureFileWriter( );
+
+    SignatureFileWriter( const SignatureFileWriter& ) = delete;
+    SignatureFileWriter& operator=( const SignatureFileWriter& ) = delete;
+
+    bool Open( const std::string& path, size_t bufferSize = 1 << 20 );
+    // Returns false if writing failed
+    bool Close( );
+    void Write( uint64_t ea, const Signature& signature, SignatureType type, size_t targetOffset = 0 );
+
+private:
+    void Flush( );
+
+    std::ofstream file;
+    std::vector<char> buffer;
+    size_t used = 0;
+};
+
+// Input functions
+Signature ParseIDASignatureString( std::string_view signatureString );
+
+// Partial wildcards
+WildcardGranularity GetWildcardGranularity( SignatureType type );
+// Widen partial wildcards to what the granularity can express
+void ApplyWildcardGranularity( SignatureByte& byte, WildcardGranularity granularity );
+void ApplyWildcardGranularity( Signature& signature, WildcardGranularity granularity );
 
 // Utility functions
-void AddByteToSignature( Signature& signature, ea_t address, bool wildcard );
-void AddBytesToSignature( Signature& signature, ea_t address, size_t count, bool wildcard );
+void AddByteToSignature( Signature& signature, const Database& database, uint64_t address, bool wildcard );
+void AddBytesToSignature( Signature& signature, const Database& database, uint64_t address, size_t count, bool wildcard );
 void TrimSignature( Signature& signature );
\ No newline at end of file
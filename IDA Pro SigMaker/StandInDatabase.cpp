@@ -0,0 +1,343 @@
+#include "StandInDatabase.h"
+#include "X86Decoder.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+constexpr uint64_t SYNTHETIC_IMAGE_BASE = 0x140001000;
+constexpr uint64_t SYNTHETIC_SEGMENT_GAP = 0x1000;
+
+StandInDatabase::StandInDatabase( std::string name, std::vector<Segment> segments, StandInISA isa ) : name( std::move( name ) ), segments( std::move( segments ) ), isa( isa ) {
+    std::ranges::sort( this->segments, []( const auto& a, const auto& b ) { return a.startEA < b.startEA; } );
+}
+
+std::vector<SegmentRange> StandInDatabase::GetSegments( ) const {
+    std::vector<SegmentRange> ranges;
+    for( const auto& segment : segments ) {
+        ranges.push_back( { segment.startEA, segment.startEA + segment.bytes.size( ) } );
+    }
+    return ranges;
+}
+
+const StandInDatabase::Segment* StandInDatabase::FindSegment( uint64_t ea ) const {
+    for( const auto& segment : segments ) {
+        if( ea >= segment.startEA && ea < segment.startEA + segment.bytes.size( ) ) {
+            return &segment;
+        }
+    }
+    return nullptr;
+}
+
+size_t StandInDatabase::ReadBytes( uint64_t ea, uint8_t* buffer, size_t size ) const {
+    // Unmapped bytes read as 0xFF, like IDA does
+    std::memset( buffer, 0xFF, size );
+
+    size_t bytesRead = 0;
+    for( const auto& segment : segments ) {
+        const auto segmentEnd = segment.startEA + segment.bytes.size( );
+        const auto start = std::max( ea, segment.startEA );
+        const auto end = std::min( ea + size, segmentEnd );
+        if( start >= end ) {
+            continue;
+        }
+        std::memcpy( buffer + ( start - ea ), segment.bytes.data( ) + ( start - segment.startEA ), end - start );
+        bytesRead += end - start;
+    }
+    return bytesRead;
+}
+
+bool StandInDatabase::IsCode( uint64_t ea ) const {
+    const auto segment = FindSegment( ea );
+    return segment && segment->executable;
+}
+
+// Toy instruction set: the low 3 bits of the opcode are the operand byte count, bit 6 marks a wildcardable operand
+static size_t DecodeSyntheticInstruction( const uint8_t* bytes, size_t available, uint32_t operandTypeBitmask, DecodedInstruction& instruction ) {
+    const auto opcode = bytes[0];
+    const size_t length = 1 + ( opcode & 7 );
+    if( length > available ) {
+        return 0;
+    }
+
+    instruction = {};
+    instruction.length = length;
+    if( operandTypeBitmask != 0 && ( opcode & 0x40 ) && length > 1 ) {
+        instruction.operandOffset = 1;
+        instruction.operandLength = static_cast<uint8_t>( length - 1 );
+    }
+    return length;
+}
+
+bool StandInDatabase::DecodeInstruction( uint64_t ea, uint32_t operandTypeBitmask, WildcardGranularity granularity, DecodedInstruction& instruction ) const {
+    const auto segment = FindSegment( ea );
+    if( !segment || !segment->executable ) {
+        return false;
+    }
+
+    const auto offset = ea - segment->startEA;
+    const auto bytes = segment->bytes.data( ) + offset;
+    const auto available = segment->bytes.size( ) - offset;
+
+    switch( isa ) {
+    case StandInISA::Synthetic:
+        return DecodeSyntheticInstruction( bytes, available, operandTypeBitmask, instruction ) > 0;
+    case StandInISA::ByteWise:
+        instruction = {};
+        instruction.length = 1;
+        return true;
+    case StandInISA::X86:
+    case StandInISA::X64:
+    {
+        X86Instruction x86Instruction;
+        if( !DecodeX86Instruction( bytes, available, isa == StandInISA::X64, x86Instruction ) ) {
+            return false;
+        }
+
+        instruction = {};
+        instruction.length = x86Instruction.length;
+        uint8_t operandOffset = 0, operandLength = 0;
+        if( operandTypeBitmask != 0 && GetX86OperandWildcard( x86Instruction, operandTypeBitmask, wildcardOptimizedInstruction, operandOffset, operandLength ) && operandLength > 0 ) {
+            instruction.operandOffset = operandOffset;
+            instruction.operandLength = operandLength;
+        }
+        if( granularity != WildcardGranularity::Byte ) {
+            GetX86OperandMatchMasks( x86Instruction, operandTypeBitmask, instruction.matchMasks );
+            instruction.hasMatchMasks = true;
+        }
+        return true;
+    }
+    }
+    return false;
+}
+
+uint64_t StandInDatabase::GetFunctionStart( uint64_t ) const {
+    // Raw images carry no function information
+    return BAD_ADDRESS;
+}
+
+uint64_t StandInDatabase::GetPreviousInstruction( uint64_t ea ) const {
+    // Raw bytes can't be decoded backwards, look the address up in a linear sweep instead
+    if( instructionStarts.empty( ) ) {
+        instructionStarts = GetInstructionAddresses( std::numeric_limits<size_t>::max( ) );
+    }
+
+    const auto next = std::ranges::lower_bound( instructionStarts, ea );
+    if( next == instructionStarts.begin( ) ) {
+        return BAD_ADDRESS;
+    }
+
+    const auto previous = *std::prev( next );
+    DecodedInstruction instruction;
+    if( !DecodeInstruction( previous, 0, WildcardGranularity::Byte, instruction ) || previous + instruction.length != ea ) {
+        return BAD_ADDRESS;
+    }
+    return previous;
+}
+
+size_t StandInDatabase::GetImageSize( ) const {
+    size_t size = 0;
+    for( const auto& segment : segments ) {
+        size += segment.bytes.size( );
+    }
+    return size;
+}
+
+std::vector<uint64_t> StandInDatabase::GetInstructionAddresses( size_t maxCount ) const {
+    std::vector<uint64_t> addresses;
+    for( const auto& segment : segments ) {
+        if( !segment.executable ) {
+            continue;
+        }
+
+        auto ea = segment.startEA;
+        const auto end = segment.startEA + segment.bytes.size( );
+        DecodedInstruction instruction;
+        while( ea < end && addresses.size( ) < maxCount ) {
+            // Resynchronize on the next byte after data or padding inside code
+            if( !DecodeInstruction( ea, 0, WildcardGranularity::Byte, instruction ) ) {
+                ea++;
+                continue;
+            }
+            addresses.push_back( ea );
+            ea += instruction.length;
+        }
+    }
+    return addresses;
+}
+
+template<typename T>
+static T ReadValue( const std::vector<uint8_t>& file, size_t offset ) {
+    T value{};
+    if( offset + sizeof( T ) <= file.size( ) ) {
+        std::memcpy( &value, file.data( ) + offset, sizeof( T ) );
+    }
+    return value;
+}
+
+static StandInDatabase::Segment CopySegment( const std::vector<uint8_t>& file, uint64_t startEA, size_t fileOffset, size_t fileSize, size_t virtualSize, bool executable ) {
+    StandInDatabase::Segment segment{ startEA, std::vector<uint8_t>( std::max( fileSize, virtualSize ), 0 ), executable };
+    if( fileOffset < file.size( ) ) {
+        const auto available = std::min( fileSize, file.size( ) - fileOffset );
+        std::memcpy( segment.bytes.data( ), file.data( ) + fileOffset, available );
+    }
+    return segment;
+}
+
+static std::vector<StandInDatabase::Segment> ParsePE( const std::vector<uint8_t>& file, StandInISA& isa ) {
+    constexpr uint32_t IMAGE_SCN_CNT_CODE = 0x00000020;
+    constexpr uint32_t IMAGE_SCN_MEM_EXECUTE = 0x20000000;
+
+    std::vector<StandInDatabase::Segment> segments;
+    const auto ntHeaders = ReadValue<uint32_t>( file, 0x3C );
+    if( ReadValue<uint32_t>( file, ntHeaders ) != 0x00004550 ) { // "PE\0\0"
+        return segments;
+    }
+
+    const auto fileHeader = ntHeaders + 4;
+    switch( ReadValue<uint16_t>( file, fileHeader ) ) {
+    case 0x014C: // IMAGE_FILE_MACHINE_I386
+        isa = StandInISA::X86;
+        break;
+    case 0x8664: // IMAGE_FILE_MACHINE_AMD64
+        isa = StandInISA::X64;
+        break;
+    }
+    const auto sectionCount = ReadValue<uint16_t>( file, fileHeader + 2 );
+    const auto optionalHeaderSize = ReadValue<uint16_t>( file, fileHeader + 16 );
+    const auto optionalHeader = fileHeader + 20;
+    const auto magic = ReadValue<uint16_t>( file, optionalHeader );
+    const uint64_t imageBase = magic == 0x20B ? ReadValue<uint64_t>( file, optionalHeader + 24 ) : ReadValue<uint32_t>( file, optionalHeader + 28 );
+
+    for( size_t i = 0; i < sectionCount; i++ ) {
+        const auto section = optionalHeader + optionalHeaderSize + i * 40;
+        const auto virtualSize = ReadValue<uint32_t>( file, section + 8 );
+        const auto virtualAddress = ReadValue<uint32_t>( file, section + 12 );
+        const auto rawSize = ReadValue<uint32_t>( file, section + 16 );
+        const auto rawOffset = ReadValue<uint32_t>( file, section + 20 );
+        const auto characteristics = ReadValue<uint32_t>( file, section + 36 );
+        const bool executable = characteristics & ( IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE );
+        segments.push_back( CopySegment( file, imageBase + virtualAddress, rawOffset, rawSize, virtualSize, executable ) );
+    }
+    return segments;
+}
+
+static std::vector<StandInDatabase::Segment> ParseELF( const std::vector<uint8_t>& file, StandInISA& isa ) {
+    constexpr uint32_t PT_LOAD = 1;
+    constexpr uint32_t PF_X = 1;
+
+    std::vector<StandInDatabase::Segment> segments;
+    if( ReadValue<uint32_t>( file, 0 ) != 0x464C457F ) { // "\x7FELF"
+        return segments;
+    }
+
+    const bool is64Bit = file[4] == 2;
+    switch( ReadValue<uint16_t>( file, 0x12 ) ) {
+    case 3: // EM_386
+        isa = StandInISA::X86;
+        break;
+    case 62: // EM_X86_64
+        isa = StandInISA::X64;
+        break;
+    }
+    const uint64_t programHeaders = is64Bit ? ReadValue<uint64_t>( file, 0x20 ) : ReadValue<uint32_t>( file, 0x1C );
+    const auto programHeaderSize = ReadValue<uint16_t>( file, is64Bit ? 0x36 : 0x2A );
+    const auto programHeaderCount = ReadValue<uint16_t>( file, is64Bit ? 0x38 : 0x2C );
+
+    for( size_t i = 0; i < programHeaderCount; i++ ) {
+        const auto header = programHeaders + i * programHeaderSize;
+        if( ReadValue<uint32_t>( file, header ) != PT_LOAD ) {
+            continue;
+        }
+
+        if( is64Bit ) {
+            const auto flags = ReadValue<uint32_t>( file, header + 4 );
+            const auto offset = ReadValue<uint64_t>( file, header + 8 );
+            const auto virtualAddress = ReadValue<uint64_t>( file, header + 16 );
+            const auto fileSize = ReadValue<uint64_t>( file, header + 32 );
+            const auto memorySize = ReadValue<uint64_t>( file, header + 40 );
+            segments.push_back( CopySegment( file, virtualAddress, offset, fileSize, memorySize, flags & PF_X ) );
+        }
+        else {
+            const auto offset = ReadValue<uint32_t>( file, header + 4 );
+            const auto virtualAddress = ReadValue<uint32_t>( file, header + 8 );
+            const auto fileSize = ReadValue<uint32_t>( file, header + 16 );
+            const auto memorySize = ReadValue<uint32_t>( file, header + 20 );
+            const auto flags = ReadValue<uint32_t>( file, header + 24 );
+            segments.push_back( CopySegment( file, virtualAddress, offset, fileSize, memorySize, flags & PF_X ) );
+        }
+    }
+    return segments;
+}
+
+std::unique_ptr<StandInDatabase> LoadStandInImage( const std::string& path ) {
+    std::ifstream stream( path, std::ios::binary );
+    if( !stream ) {
+        return nullptr;
+    }
+    std::vector<uint8_t> file( ( std::istreambuf_iterator<char>( stream ) ), std::istreambuf_iterator<char>( ) );
+    if( file.empty( ) ) {
+        return nullptr;
+    }
+
+    auto isa = StandInISA::ByteWise;
+    auto segments = ParsePE( file, isa );
+    if( segments.empty( ) ) {
+        segments = ParseELF( file, isa );
+    }
+    if( segments.empty( ) ) {
+        segments.push_back( { 0, std::move( file ), true } );
+    }
+    return std::make_unique<StandInDatabase>( path, std::move( segments ), isa );
+}
+
+std::unique_ptr<StandInDatabase> CreateSyntheticDatabase( size_t size, uint64_t seed, size_t segmentCount ) {
+    std::mt19937_64 random( seed );
+
+    // Skewed opcode distribution, a few opcodes make up most of the code like in compiler output
+    std::vector<uint8_t> opcodes( 64 );
+    for( auto& opcode : opcodes ) {
+        opcode = static_cast<uint8_t>( random( ) );
+    }
+    std::geometric_distribution<size_t> opcodeDistribution( 0.08 );
+
+    std::vector<uint8_t> code;
+    std::vector<size_t> instructionStarts;
+    code.reserve( size + 8 );
+    while( code.size( ) < size ) {
+        // Copy-paste a run of earlier instructions, e.g. inlined functions
+        if( instructionStarts.size( ) > 64 && random( ) % 32 == 0 ) {
+            const auto first = random( ) % ( instructionStarts.size( ) - 32 );
+            const auto count = 4 + random( ) % 28;
+            const auto start = instructionStarts[first];
+            const auto end = instructionStarts[first + count];
+            for( size_t i = first; i < first + count; i++ ) {
+                instructionStarts.push_back( code.size( ) + ( instructionStarts[i] - start ) );
+            }
+            const std::vector<uint8_t> block( code.begin( ) + start, code.begin( ) + end );
+            code.insert( code.end( ), block.begin( ), block.end( ) );
+            continue;
+        }
+
+        instructionStarts.push_back( code.size( ) );
+        const auto opcode = opcodes[std::min( opcodeDistribution( random ), opcodes.size( ) - 1 )];
+        code.push_back( opcode );
+        for( size_t i = 0; i < static_cast<size_t>( opcode & 7 ); i++ ) {
+            // Operands are random, other bytes come from a small set like register encodings
+            code.push_back( static_cast<uint8_t>( ( opcode & 0x40 ) ? random( ) : random( ) % 16 ) );
+        }
+    }
+    code.resize( size );
+
+    std::vector<StandInDatabase::Segment> segments;
+    segmentCount = std::max<size_t>( segmentCount, 1 );
+    const auto segmentSize = ( size + segmentCount - 1 ) / segmentCount;
+    auto ea = SYNTHETIC_IMAGE_BASE;
+    for( size_t offset = 0; offset < size; offset += segmentSize ) {
+        const auto end = std::min( offset + segmentSize, size );
+        segments.push_back( { ea, std::vector<uint8_t>( code.begin( ) + offset, code.begin( ) + end ), true } );
+        ea += ( end - offset ) + SYNTHETIC_SEGMENT_GAP;
+    }
+    return std::make_unique<StandInDatabase>( "synthetic", std::move( segments ), StandInISA::Synthetic );
+}
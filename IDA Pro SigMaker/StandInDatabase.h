@@ -0,0 +1,55 @@
+#pragma once
+#include "Database.h"
+#include <memory>
+#include <string>
+
+// How a stand-in image is decoded
+enum class StandInISA : uint32_t {
+    Synthetic = 0, // Variable length toy instruction set produced by CreateSyntheticDatabase
+    ByteWise,       // No decoder available, every byte is its own instruction without operands
+    X86,            // Built-in x86 decoder
+    X64             // Built-in x64 decoder
+};
+
+// IDA-free database fed from raw PE/ELF files or synthetic byte corpora
+class StandInDatabase final : public Database {
+public:
+    struct Segment {
+        uint64_t startEA;
+        std::vector<uint8_t> bytes;
+        bool executable;
+    };
+
+    StandInDatabase( std::string name, std::vector<Segment> segments, StandInISA isa );
+
+    std::vector<SegmentRange> GetSegments( ) const override;
+    size_t ReadBytes( uint64_t ea, uint8_t* buffer, size_t size ) const override;
+    bool IsCode( uint64_t ea ) const override;
+    bool DecodeInstruction( uint64_t ea, uint32_t operandTypeBitmask, WildcardGranularity granularity, DecodedInstruction& instruction ) const override;
+    uint64_t GetFunctionStart( uint64_t ea ) const override;
+    uint64_t GetPreviousInstruction( uint64_t ea ) const override;
+
+    const std::string& GetName( ) const {
+        return name;
+    }
+    size_t GetImageSize( ) const;
+    // Addresses of instructions inside executable segments, in ascending order
+    std::vector<uint64_t> GetInstructionAddresses( size_t maxCount ) const;
+
+private:
+    const Segment* FindSegment( uint64_t ea ) const;
+
+    std::string name;
+    std::vector<Segment> segments;
+    StandInISA isa;
+    // Linear sweep of all executable segments, created on first use
+    mutable std::vector<uint64_t> instructionStarts;
+};
+
+// Load a raw PE or ELF file by its sections / program headers, anything else is mapped as one flat code segment at 0
+// x86 and x64 images are decoded with the built-in decoder
+std::unique_ptr<StandInDatabase> LoadStandInImage( const std::string& path );
+
+// Synthetic code with skewed opcode frequencies and copy-pasted blocks, so signatures have to grow like in real binaries
+// The image is split into `segmentCount` segments with gaps in between
+std::unique_ptr<StandInDatabase> CreateSyntheticDatabase( size_t size, uint64_t seed, size_t segmentCount = 1 );
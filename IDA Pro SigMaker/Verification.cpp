@@ -0,0 +1,531 @@
+#include "Verification.h"
+#include "SigMakerPattern.hpp"
+#include "SignatureGenerator.h"
+#include "SignatureUtils.h"
+#include "StandInDatabase.h"
+#include "X86Decoder.h"
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <random>
+
+using VerificationClock = std::chrono::steady_clock;
+
+struct TestPattern {
+    const char* kind;
+    Signature signature;
+};
+
+static Signature PatternFromBuffer( const SegmentBuffer& buffer, size_t offset, size_t length ) {
+    Signature signature;
+    for( size_t i = 0; i < length && offset + i < buffer.data.size( ); i++ ) {
+        signature.push_back( { buffer.data[offset + i], false } );
+    }
+    return signature;
+}
+
+static std::vector<TestPattern> BuildTestPatterns( const SegmentBuffer& buffer, const VerificationOptions& options ) {
+    std::vector<TestPattern> patterns;
+    if( buffer.Empty( ) ) {
+        return patterns;
+    }
+
+    // Patterns cut short by the end of the buffer may be empty, those are not tested
+    auto addPattern = [&patterns]( const char* kind, Signature signature ) {
+        if( !signature.empty( ) ) {
+            patterns.push_back( { kind, std::move( signature ) } );
+        }
+    };
+
+    std::mt19937_64 random( options.seed );
+    auto randomBlockOffset = [&]( size_t& offset, size_t& available ) {
+        const auto& block = buffer.blocks[random( ) % buffer.blocks.size( )];
+        const auto position = random( ) % block.size;
+        offset = block.offset + position;
+        available = block.size - position;
+    };
+
+    for( size_t i = 0; i < options.randomPatterns; i++ ) {
+        size_t offset, available;
+        randomBlockOffset( offset, available );
+
+        // Random pattern with random wildcards, sampled from the image so it has at least one hit
+        auto signature = PatternFromBuffer( buffer, offset, std::min<size_t>( available, 1 + random( ) % 48 ) );
+        for( auto& byte : signature ) {
+            byte.isWildcard = random( ) % 4 == 0;
+        }
+        addPattern( "random", std::move( signature ) );
+
+        // Nibble and bit-level wildcards
+        auto partial = PatternFromBuffer( buffer, offset, std::min<size_t>( available, 1 + random( ) % 48 ) );
+        for( auto& byte : partial ) {
+            switch( random( ) % 4 ) {
+            case 0:
+                byte.mask = 0xF0;
+                break;
+            case 1:
+                byte.mask = 0x0F;
+                break;
+            case 2:
+                byte.mask = static_cast<uint8_t>( 1 + random( ) % 255 );
+                break;
+            }
+        }
+        addPattern( "partial wildcards", std::move( partial ) );
+
+        // Leading and trailing wildcards
+        auto leading = PatternFromBuffer( buffer, offset, std::min<size_t>( available, 2 + random( ) % 16 ) );
+        const auto leadingCount = std::min( leading.size( ) - 1, 1 + random( ) % 8 );
+        for( size_t j = 0; j < leadingCount; j++ ) {
+            leading[j].isWildcard = true;
+        }
+        addPattern( "leading wildcards", std::move( leading ) );
+
+        auto trailing = PatternFromBuffer( buffer, offset, std::min<size_t>( available, 2 + random( ) % 16 ) );
+        const auto trailingCount = std::min( trailing.size( ) - 1, 1 + random( ) % 8 );
+        for( size_t j = 0; j < trailingCount; j++ ) {
+            trailing[trailing.size( ) - 1 - j].isWildcard = true;
+        }
+        addPattern( "trailing wildcards", std::move( trailing ) );
+
+        // Short patterns with many overlapping hits
+        addPattern( "short", PatternFromBuffer( buffer, offset, std::min<size_t>( available, 1 + random( ) % 2 ) ) );
+    }
+
+    // All-wildcard runs, every position matches
+    Signature allWildcards;
+    for( size_t length = 1; length <= 4; length++ ) {
+        allWildcards.push_back( { 0, true } );
+        addPattern( "all wildcards", allWildcards );
+    }
+
+    for( size_t i = 0; i < buffer.blocks.size( ); i++ ) {
+        const auto& block = buffer.blocks[i];
+
+        // Hits at the very start and end of a block
+        for( size_t length = 1; length <= 16 && length <= block.size; length++ ) {
+            addPattern( "block start", PatternFromBuffer( buffer, block.offset, length ) );
+            addPattern( "block end", PatternFromBuffer( buffer, block.offset + block.size - length, length ) );
+        }
+
+        // Bytes spanning a gap to the next block must not match across it
+        if( i + 1 < buffer.blocks.size( ) ) {
+            for( size_t before = 1; before <= 8 && before <= block.size; before++ ) {
+                addPattern( "across gap", PatternFromBuffer( buffer, block.offset + block.size - before, before + 1 + random( ) % 8 ) );
+            }
+        }
+
+        // Hits straddling chunk boundaries inside a block
+        for( size_t chunk = SCAN_CHUNK_SIZE; chunk < block.size; chunk += SCAN_CHUNK_SIZE ) {
+            for( size_t before = 1; before <= 16 && before <= chunk; before++ ) {
+                const auto length = std::min<size_t>( block.size - ( chunk - before ), before + 1 + random( ) % 16 );
+                addPattern( "chunk boundary", PatternFromBuffer( buffer, block.offset + chunk - before, length ) );
+            }
+        }
+    }
+
+    return patterns;
+}
+
+VerificationResult VerifyScanEngines( Database& database, std::string_view name, const VerificationOptions& options ) {
+    VerificationResult result;
+    if( !options.print ) {
+        return result;
+    }
+
+    const auto previousEngine = database.scanEngine;
+    const auto& buffer = database.GetSegmentBuffer( );
+    const auto patterns = BuildTestPatterns( buffer, options );
+    result.patterns = patterns.size( );
+    options.print( std::format( "Verifying scan engines on {} ({:.1f} MiB, {} blocks, {} patterns)\n", name, buffer.data.size( ) / ( 1024.0 * 1024.0 ), buffer.blocks.size( ), patterns.size( ) ) );
+
+    // Ground truth
+    std::vector<std::vector<uint64_t>> expected;
+    expected.reserve( patterns.size( ) );
+    for( const auto& pattern : patterns ) {
+        expected.push_back( FindSignatureOccurencesInBuffer( buffer, pattern.signature, ScanEngine::Reference, options.hitLimit ) );
+    }
+
+    for( const auto engine : options.engines ) {
+        database.scanEngine = engine;
+        size_t mismatches = 0;
+        double seconds = 0;
+        for( size_t i = 0; i < patterns.size( ); i++ ) {
+            const auto start = VerificationClock::now( );
+            const auto hits = database.FindOccurences( patterns[i].signature, options.hitLimit );
+            seconds += std::chrono::duration<double>( VerificationClock::now( ) - start ).count( );
+
+            if( hits == expected[i] ) {
+                continue;
+            }
+
+            // Print the first few mismatches in detail
+            if( ++mismatches <= 10 ) {
+                const auto difference = std::ranges::mismatch( hits, expected[i] );
+                const auto actualHit = difference.in1 != hits.end( ) ? std::format( "{:X}", *difference.in1 ) : std::string( "none" );
+                const auto expectedHit = difference.in2 != expected[i].end( ) ? std::format( "{:X}", *difference.in2 ) : std::string( "none" );
+                options.print( std::format( "  MISMATCH {} ({}): {} hits instead of {}, got {} where {} was expected: {}\n",
+                    GetScanEngineName( engine ), patterns[i].kind, hits.size( ), expected[i].size( ), actualHit, expectedHit, BuildIDASignatureString( patterns[i].signature ) ) );
+            }
+        }
+        result.mismatches += mismatches;
+
+        // Every pattern scans the image at most once
+        options.print( std::format( "  {:<12} {:>6} mismatches, {:.2f} s, {:.1f} MB/s\n", GetScanEngineName( engine ), mismatches, seconds, ( buffer.data.size( ) * patterns.size( ) ) / ( seconds * 1e6 ) ) );
+    }
+
+    database.scanEngine = previousEngine;
+    return result;
+}
+
+VerificationResult VerifyScanEnginesOnStandIns( const VerificationOptions& options ) {
+    VerificationResult result;
+    auto accumulate = [&result]( const VerificationResult& other ) {
+        result.patterns += other.patterns;
+        result.mismatches += other.mismatches;
+    };
+
+    // Synthetic code in several segments, large enough for a few chunks
+    auto synthetic = CreateSyntheticDatabase( 3 * SCAN_CHUNK_SIZE + 12345, options.seed, 3 );
+    accumulate( VerifyScanEngines( *synthetic, "synthetic, gapped segments", options ) );
+
+    // Contiguous segments, padding runs, periodic bytes and segments smaller than most patterns
+    std::mt19937_64 random( options.seed );
+    std::vector<StandInDatabase::Segment> segments;
+    uint64_t ea = 0x10000;
+    auto addSegment = [&]( std::vector<uint8_t> bytes, uint64_t gap ) {
+        const auto size = bytes.size( );
+        segments.push_back( { ea, std::move( bytes ), true } );
+        ea += size + gap;
+    };
+
+    std::vector<uint8_t> randomBytes( 2 * SCAN_CHUNK_SIZE + 77 );
+    for( auto& byte : randomBytes ) {
+        byte = static_cast<uint8_t>( random( ) % 8 );
+    }
+    addSegment( randomBytes, 0 );
+    addSegment( std::vector<uint8_t>( 4096, 0xCC ), 0 );
+    std::vector<uint8_t> periodic( 4096 );
+    for( size_t i = 0; i < periodic.size( ); i++ ) {
+        periodic[i] = i % 2 ? 0xAB : 0xCD;
+    }
+    addSegment( periodic, 0x100 );
+    addSegment( { 0xCC }, 0x10 );
+    addSegment( { 0xAB, 0xCD, 0xCC }, 0x1000 );
+    addSegment( std::vector<uint8_t>( SCAN_CHUNK_SIZE + 3, 0x90 ), 0 );
+
+    StandInDatabase adversarial( "adversarial", std::move( segments ), StandInISA::ByteWise );
+    accumulate( VerifyScanEngines( adversarial, "adversarial layout", options ) );
+    return result;
+}
+
+struct KnownEncoding {
+    const char* name;
+    const char* bytes;
+    bool is64Bit;
+    // 0 for encodings that have to be rejected
+    uint8_t length;
+    // Wildcard range for memory, immediate and branch operands, like the plugin's default bitmask without registers
+    uint8_t operandOffset;
+    uint8_t operandLength;
+};
+
+// clang-format off
+static constexpr KnownEncoding KNOWN_ENCODINGS[] = {
+    { "ret",                           "C3",                            true,  1,  0, 0 },
+    { "call rel32",                    "E8 10 20 30 40",                true,  5,  1, 4 },
+    { "jmp rel8",                      "EB 05",                         true,  2,  1, 1 },
+    { "jz rel32",                      "0F 84 10 20 30 40",             true,  6,  2, 4 },
+    { "mov [rsp+8], rbx",              "48 89 5C 24 08",                true,  5,  4, 1 },
+    { "mov rax, [rip+x]",              "48 8B 05 10 20 30 40",          true,  7,  3, 4 },
+    { "mov dword [rsp+10h], imm32",    "C7 44 24 10 01 00 00 00",       true,  8,  3, 5 },
+    { "sub rsp, imm32",                "48 81 EC 28 01 00 00",          true,  7,  3, 4 },
+    { "mov rax, imm64",                "48 B8 01 02 03 04 05 06 07 08", true,  10, 2, 8 },
+    { "mov ax, imm16",                 "66 B8 34 12",                   true,  4,  2, 2 },
+    { "mov eax, [moffs64]",            "A1 01 02 03 04 05 06 07 08",    true,  9,  1, 8 },
+    { "call r8",                       "41 FF D0",                      true,  3,  0, 0 },
+    { "nop word [rax+rax]",            "66 0F 1F 44 00 00",             true,  6,  5, 1 },
+    { "syscall",                       "0F 05",                         true,  2,  0, 0 },
+    { "getsec",                        "0F 37",                         true,  2,  0, 0 },
+    { "getsec, 32-bit",                "0F 37",                         false, 2,  0, 0 },
+    { "reserved 0F 36",                "0F 36",                         true,  0,  0, 0 },
+    { "palignr xmm0, xmm1, 8",         "66 0F 3A 0F C1 08",             true,  6,  5, 1 },
+    { "vzeroupper",                    "C5 F8 77",                      true,  3,  0, 0 },
+    { "vbroadcastss xmm0, [rip+x]",    "C4 E2 79 18 05 10 20 30 40",    true,  9,  5, 4 },
+    { "vmovups zmm0, [rsp+40h]",       "62 F1 7C 48 10 44 24 01",       true,  8,  7, 1 },
+    { "push imm32, 32-bit",            "68 10 20 30 40",                false, 5,  1, 4 },
+    { "mov eax, [moffs32], 32-bit",    "A1 10 20 30 40",                false, 5,  1, 4 },
+    { "call far ptr, 32-bit",          "9A 10 20 30 40 50 60",          false, 7,  1, 6 },
+    { "call far ptr, 64-bit",          "9A 10 20 30 40 50 60",          true,  0,  0, 0 },
+    { "truncated call rel32",          "E8 10 20",                      true,  0,  0, 0 },
+};
+// clang-format on
+
+VerificationResult VerifyX86DecoderOnKnownEncodings( const std::function<void( std::string_view line )>& print ) {
+    constexpr uint32_t operandTypeBitmask = ( 1 << X86_Mem ) | ( 1 << X86_Phrase ) | ( 1 << X86_Displ ) | ( 1 << X86_Imm ) | ( 1 << X86_Far ) | ( 1 << X86_Near );
+    VerificationResult result;
+    for( const auto& encoding : KNOWN_ENCODINGS ) {
+        uint8_t bytes[16]{ };
+        size_t byteCount = 0;
+        for( std::string_view text = encoding.bytes; text.size( ) >= 2; text.remove_prefix( std::min<size_t>( text.size( ), 3 ) ) ) {
+            bytes[byteCount++] = static_cast<uint8_t>( std::stoul( std::string( text.substr( 0, 2 ) ), nullptr, 16 ) );
+        }
+
+        X86Instruction instruction;
+        uint8_t operandOffset = 0, operandLength = 0;
+        const bool isValid = DecodeX86Instruction( bytes, byteCount, encoding.is64Bit, instruction );
+        if( isValid ) {
+            GetX86OperandWildcard( instruction, operandTypeBitmask, false, operandOffset, operandLength );
+        }
+
+        result.patterns++;
+        const bool matches = encoding.length == 0 ? !isValid
+                                                  : isValid && instruction.length == encoding.length && operandOffset == encoding.operandOffset && operandLength == encoding.operandLength;
+        if( !matches ) {
+            result.mismatches++;
+            if( print ) {
+                print( std::format( "  MISMATCH {} ({}): {} length {} wildcard {}+{}, expected {} length {} wildcard {}+{}\n", encoding.name, encoding.bytes, isValid ? "valid" : "invalid",
+                    instruction.length, operandOffset, operandLength, encoding.length != 0 ? "valid" : "invalid", encoding.length, encoding.operandOffset, encoding.operandLength ) );
+            }
+        }
+    }
+    if( print ) {
+        print( std::format( "Verified the x86 decoder on {} known encodings, {} mismatches\n", result.patterns, result.mismatches ) );
+    }
+    return result;
+}
+
+VerificationResult VerifyTargetOffsetsOnStandIns( const std::function<void( std::string_view line )>& print ) {
+    // push rbx is wildcarded completely when register operands are, "push imm32" with random immediates makes its neighbours unique
+    std::mt19937_64 random( 1337 );
+    std::vector<uint8_t> code( 64, 0x53 );
+    auto addPush = [&]( ) {
+        code.push_back( 0x68 );
+        for( int i = 0; i < 4; i++ ) {
+            code.push_back( static_cast<uint8_t>( random( ) ) );
+        }
+    };
+
+    constexpr uint64_t startEA = 0x140001000;
+    std::vector<uint64_t> targets;
+    for( size_t i = 0; i < 32; i++ ) {
+        // Unique code after the target, before it, or on both sides
+        if( i % 3 != 0 ) {
+            addPush( );
+        }
+        targets.push_back( startEA + code.size( ) );
+        code.push_back( 0x53 );
+        if( i % 3 != 1 ) {
+            addPush( );
+        }
+        code.insert( code.end( ), 8, 0x53 );
+    }
+    // Last instruction of the segment, it can only grow backwards and ends with a wildcard
+    addPush( );
+    targets.push_back( startEA + code.size( ) );
+    code.push_back( 0x53 );
+
+    StandInDatabase database( "wildcard targets", { { startEA, std::move( code ), true } }, StandInISA::X64 );
+    database.scanEngine = ScanEngine::Masked;
+    database.wildcardOptimizedInstruction = true;
+    GeneratorOptions options;
+    options.operandTypeBitmask = 1 << X86_Reg;
+    options.continueOutsideOfFunction = true;
+
+    VerificationResult result;
+    for( const auto ea : targets ) {
+        result.patterns++;
+        const auto signature = GenerateUniqueSignatureAroundEA( database, ea, options );
+        const auto matches = signature.has_value( ) ? database.FindOccurences( signature->signature, 2 ) : std::vector<uint64_t>{ };
+        if( signature.has_value( ) && signature->targetOffset < signature->signature.size( ) && matches.size( ) == 1 && matches.front( ) + signature->targetOffset == ea ) {
+            continue;
+        }
+
+        result.mismatches++;
+        if( print ) {
+            print( signature.has_value( ) ? std::format( "  MISMATCH target {:X}: {} at offset {}, {} matches\n", ea, BuildIDASignatureString( signature->signature ), signature->targetOffset, matches.size( ) )
+                                          : std::format( "  MISMATCH target {:X}: {}\n", ea, signature.error( ) ) );
+        }
+    }
+    if( print ) {
+        print( std::format( "Verified target offsets of {} signatures around wildcard targets, {} mismatches\n", result.patterns, result.mismatches ) );
+    }
+    return result;
+}
+
+// Pattern from SigMakerPattern.hpp, with its text so the compile-time parse can be checked against ParseIDASignatureString
+struct PatternHeaderCase {
+    const char* text;
+    size_t size;
+    size_t targetOffset;
+    std::vector<sigmaker::PatternByte> bytes;
+    std::function<const uint8_t*( const uint8_t* data, size_t size )> find;
+    std::function<const uint8_t*( const uint8_t* data, size_t size )> findTarget;
+    std::function<void( const uint8_t* data, size_t size, const std::function<bool( const uint8_t* match )>& callback )> findAll;
+};
+
+template <sigmaker::FixedString Text>
+static PatternHeaderCase MakePatternHeaderCase( ) {
+    using PatternType = sigmaker::Pattern<Text>;
+    static constexpr auto text = Text;
+    return { text.text, PatternType::Size, PatternType::TargetOffset, { PatternType::Bytes.begin( ), PatternType::Bytes.end( ) }, PatternType::Find, PatternType::FindTarget,
+             []( const uint8_t* data, size_t size, const std::function<bool( const uint8_t* match )>& callback ) { PatternType::FindAll( data, size, callback ); } };
+}
+
+VerificationResult VerifyPatternHeaderOnStandIns( const std::function<void( std::string_view line )>& print ) {
+    // Two anchors, one anchor, nibbles, a target, wildcards only, a single byte and a pattern longer than a vector
+    const PatternHeaderCase cases[] = {
+        MakePatternHeaderCase<"48 89 5C 24 ? 57 48 83 EC 30 [E8] ? ? ? ?">( ),
+        MakePatternHeaderCase<"E8 ? ? ? ? 90">( ),
+        MakePatternHeaderCase<"4? 8B ?5 ? ? ? ? [C3]">( ),
+        MakePatternHeaderCase<"? ?? ?">( ),
+        MakePatternHeaderCase<"CC">( ),
+        MakePatternHeaderCase<"01 02 ? 03 04 05 06 07 ? ? 01 00 02 03 04 05 06 07 00 01 02 03 ? 05 06 07 00 01 02 03 04 05 06 07 [A0]">( ),
+    };
+
+    // Bytes 0-7 and the patterns' own bytes planted at random positions, at block edges and overlapping each other
+    std::mt19937_64 random( 1337 );
+    std::vector<StandInDatabase::Segment> segments;
+    uint64_t ea = 0x10000;
+    for( const auto size : { 2 * SCAN_CHUNK_SIZE + 77, size_t( 4099 ), size_t( 40 ), size_t( 3 ) } ) {
+        std::vector<uint8_t> bytes( size );
+        for( auto& byte : bytes ) {
+            byte = static_cast<uint8_t>( random( ) % 8 );
+        }
+        for( const auto& testCase : cases ) {
+            if( testCase.size > size ) {
+                continue;
+            }
+            auto plant = [&]( size_t offset ) {
+                for( size_t i = 0; i < testCase.size; i++ ) {
+                    const auto& byte = testCase.bytes[i];
+                    bytes[offset + i] = static_cast<uint8_t>( ( byte.value & byte.mask ) | ( random( ) & ~byte.mask ) );
+                }
+            };
+            plant( 0 );
+            plant( size - testCase.size );
+            for( size_t i = 0; i < 16; i++ ) {
+                const auto offset = random( ) % ( size - testCase.size + 1 );
+                plant( offset );
+                plant( std::min( offset + 1 + random( ) % testCase.size, size - testCase.size ) );
+            }
+        }
+        // Contiguous and gapped segments alike
+        segments.push_back( { ea, std::move( bytes ), true } );
+        ea += size + ( segments.size( ) % 2 ? 0 : 0x1000 );
+    }
+    StandInDatabase database( "pattern header", std::move( segments ), StandInISA::ByteWise );
+    const auto& buffer = database.GetSegmentBuffer( );
+
+    VerificationResult result;
+    for( const auto& testCase : cases ) {
+        result.patterns++;
+        std::string text = testCase.text;
+        std::erase_if( text, []( char c ) { return c == '[' || c == ']'; } );
+        const auto signature = ParseIDASignatureString( text );
+
+        bool isParsed = signature.size( ) == testCase.size;
+        for( size_t i = 0; isParsed && i < signature.size( ); i++ ) {
+            const auto mask = signature[i].isWildcard ? 0 : signature[i].mask;
+            isParsed = testCase.bytes[i].mask == mask && testCase.bytes[i].value == ( signature[i].value & mask );
+        }
+
+        // Matches per block, the reference scanner also lets matches span contiguous segments
+        const auto expected = FindSignatureOccurencesInBuffer( buffer, signature, ScanEngine::Reference );
+        std::vector<uint64_t> found;
+        bool isFirstFound = true;
+        for( const auto& block : buffer.blocks ) {
+            const auto data = buffer.data.data( ) + block.offset;
+            testCase.findAll( data, block.size, [&]( const uint8_t* match ) {
+                found.push_back( block.startEA + ( match - data ) );
+                return true;
+            } );
+            const auto first = std::ranges::lower_bound( expected, block.startEA );
+            const auto expectedFirst = first != expected.end( ) && *first < block.startEA + block.size ? data + ( *first - block.startEA ) : nullptr;
+            isFirstFound = isFirstFound && testCase.find( data, block.size ) == expectedFirst &&
+                           testCase.findTarget( data, block.size ) == ( expectedFirst != nullptr ? expectedFirst + testCase.targetOffset : nullptr );
+        }
+
+        if( isParsed && isFirstFound && found == expected ) {
+            continue;
+        }
+        result.mismatches++;
+        if( print ) {
+            print( std::format( "  MISMATCH {}: {}, {} matches instead of {}\n", testCase.text, isParsed ? "parsed" : "parsed differently", found.size( ), expected.size( ) ) );
+        }
+    }
+    if( print ) {
+        print( std::format( "Verified SigMakerPattern.hpp with {} patterns on a stand-in image, {} mismatches\n", result.patterns, result.mismatches ) );
+    }
+    return result;
+}
+
+struct ShortestSignaturesCase {
+    const char* name;
+    size_t capacity;
+    // Length of the signature offered at each step, its address is the step
+    std::vector<size_t> lengths;
+    // 'y' where Offer has to keep the signature
+    std::string_view kept;
+    // Addresses Sorted has to return, in order
+    std::vector<uint64_t> sorted;
+};
+
+// clang-format off
+static const ShortestSignaturesCase SHORTEST_SIGNATURES_CASES[] = {
+    { "keeps the shortest",             3, { 5, 3, 5, 1, 3, 5, 2 }, "yyyyyny", { 3, 6, 1 } },
+    { "ties in offer order",            4, { 3, 1, 3 },             "yyy",     { 1, 0, 2 } },
+    { "evicts the last offered tie",    3, { 4, 4, 4, 4, 2 },       "yyyny",   { 4, 0, 1 } },
+    { "keeps replacing the longest",    2, { 9, 8, 7, 6, 5, 4 },    "yyyyyy",  { 5, 4 } },
+    { "capacity 0",                     0, { 1, 2 },                "nn",      { } },
+};
+// clang-format on
+
+VerificationResult VerifyShortestSignatures( const std::function<void( std::string_view line )>& print ) {
+    // Every byte of a signature is its address, so a slot that was overwritten only partly shows up
+    const auto makeSignature = []( uint64_t ea, size_t length ) { return Signature( length, SignatureByte{ static_cast<uint8_t>( ea ), false } ); };
+    const auto holds = []( const ShortestSignatures::Entry& entry, uint64_t ea, size_t length ) {
+        return entry.ea == ea && entry.signature.size( ) == length &&
+               std::ranges::all_of( entry.signature, [ea]( const SignatureByte& byte ) { return byte.value == static_cast<uint8_t>( ea ) && !byte.isWildcard; } );
+    };
+
+    VerificationResult result;
+    for( const auto& testCase : SHORTEST_SIGNATURES_CASES ) {
+        ShortestSignatures signatures( testCase.capacity );
+        std::string kept;
+        // The longest entry is the one an accepted offer evicts once all slots are taken, in place
+        bool isReused = true;
+        for( size_t ea = 0; ea < testCase.lengths.size( ); ea++ ) {
+            const auto before = signatures.Sorted( );
+            const bool isKept = signatures.Offer( ea, makeSignature( ea, testCase.lengths[ea] ) );
+            kept.push_back( isKept ? 'y' : 'n' );
+            if( isKept && before.size( ) == testCase.capacity ) {
+                isReused = isReused && holds( *before.back( ), ea, testCase.lengths[ea] ) && signatures.Sorted( ).size( ) == testCase.capacity;
+            }
+        }
+
+        const auto sorted = signatures.Sorted( );
+        bool isSorted = sorted.size( ) == testCase.sorted.size( );
+        for( size_t i = 0; isSorted && i < sorted.size( ); i++ ) {
+            isSorted = holds( *sorted[i], testCase.sorted[i], testCase.lengths[testCase.sorted[i]] );
+        }
+
+        result.patterns++;
+        if( kept == testCase.kept && isReused && isSorted && signatures.OfferedCount( ) == testCase.lengths.size( ) ) {
+            continue;
+        }
+        result.mismatches++;
+        if( print ) {
+            std::string addresses;
+            for( const auto* entry : sorted ) {
+                addresses += std::format( "{}{}", addresses.empty( ) ? "" : " ", entry->ea );
+            }
+            print( std::format( "  MISMATCH {}: kept {} instead of {}, sorted [{}], {}, {} offered\n", testCase.name, kept, testCase.kept, addresses,
+                isReused ? "slots reused" : "slots not reused", signatures.OfferedCount( ) ) );
+        }
+    }
+    if( print ) {
+        print( std::format( "Verified ShortestSignatures on {} offer sequences, {} mismatches\n", result.patterns, result.mismatches ) );
+    }
+    return result;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "Database.h"
+#include <functional>
+#include <string_view>
+
+struct VerificationOptions {
+    // Engines compared against the reference scanner
+    std::vector<ScanEngine> engines;
+    size_t randomPatterns = 500;
+    // Hits compared per pattern, all-wildcard patterns match everywhere
+    size_t hitLimit = 4096;
+    uint64_t seed = 1337;
+    std::function<void( std::string_view line )> print;
+};
+
+struct VerificationResult {
+    size_t patterns = 0;
+    size_t mismatches = 0;
+};
+
+// Run random and adversarial patterns through every engine and check that the hit lists match the reference scanner exactly
+VerificationResult VerifyScanEngines( Database& database, std::string_view name, const VerificationOptions& options );
+
+// Same on stand-in images built to hit the edge cases: segment gaps, contiguous segments, padding runs and tiny segments
+VerificationResult VerifyScanEnginesOnStandIns( const VerificationOptions& options );
+
+// Decode instructions with known lengths and wildcard ranges, covering every opcode map, prefix and operand encoding
+// Runs without IDA, the comparison with IDA's own decoder on a whole database is Options > Validate built-in decoder
+VerificationResult VerifyX86DecoderOnKnownEncodings( const std::function<void( std::string_view line )>& print );
+
+// Generate signatures around targets that start with wildcards, on a stand-in x64 image, and check that every one
+// matches once with its target offset pointing at the target, whichever way the signature grew
+VerificationResult VerifyTargetOffsetsOnStandIns( const std::function<void( std::string_view line )>& print );
+
+// Check the compile-time patterns of SigMakerPattern.hpp against ParseIDASignatureString and the reference scanner, on a stand-in image
+// with the patterns planted at block edges and overlapping each other. Covers the vector kernel the verification is compiled for
+VerificationResult VerifyPatternHeaderOnStandIns( const std::function<void( std::string_view line )>& print );
+
+// Offer fixed sequences of signature lengths to ShortestSignatures and check which are kept, the order Sorted returns them in,
+// ties included, and that an accepted offer overwrites the slot of the longest entry once all are taken
+VerificationResult VerifyShortestSignatures( const std::function<void( std::string_view line )>& print );
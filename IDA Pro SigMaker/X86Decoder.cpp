@@ -0,0 +1,590 @@
+#include "X86Decoder.h"
+#include <array>
+#include <cstring>
+#include <string_view>
+
+// Operand kinds used in the opcode tables
+//   E  ModRM r/m, general purpose register or memory     G  ModRM reg, general purpose register
+//   M  ModRM r/m, memory only                             V  ModRM reg, vector register
+//   W  ModRM r/m, vector register or memory               U  ModRM r/m, vector register only
+//   C  ModRM reg, control register                        D  ModRM reg, debug register
+//   T  ModRM reg, test register
+//   R  register implied by or encoded in the opcode       P  implied memory phrase, e.g. [rsi] of string instructions
+//   1  implied constant 1
+//   Ib Iw Iz Iv Id  immediate of 1, 2, 2/4, 2/4/8 or 4 bytes
+//   Jb Jz  relative branch target of 1 or 2/4 bytes      O  memory offset of address size      Ap  far pointer
+// A leading "!" marks opcodes that are invalid in 64-bit mode, empty entries are invalid or prefixes
+enum OperandKind : uint8_t {
+    Kind_None,
+    Kind_E, Kind_G, Kind_M, Kind_V, Kind_W, Kind_U, Kind_C, Kind_D, Kind_T,
+    Kind_R, Kind_P, Kind_One,
+    Kind_Ib, Kind_Iw, Kind_Iz, Kind_Iv, Kind_Id,
+    Kind_Jb, Kind_Jz, Kind_O, Kind_Ap
+};
+
+struct OpcodeEntry {
+    bool valid;
+    bool invalid64;
+    bool hasModRM;
+    uint8_t operandCount;
+    OperandKind operands[4];
+};
+
+using OpcodeTable = std::array<OpcodeEntry, 256>;
+
+// clang-format off
+static const char* const OneByteMap[256] = {
+    /* 00 */ "E G", "E G", "G E", "G E", "R Ib", "R Iz", "!R", "!R", "E G", "E G", "G E", "G E", "R Ib", "R Iz", "!R", "",
+    /* 10 */ "E G", "E G", "G E", "G E", "R Ib", "R Iz", "!R", "!R", "E G", "E G", "G E", "G E", "R Ib", "R Iz", "!R", "!R",
+    /* 20 */ "E G", "E G", "G E", "G E", "R Ib", "R Iz", "", "!-", "E G", "E G", "G E", "G E", "R Ib", "R Iz", "", "!-",
+    /* 30 */ "E G", "E G", "G E", "G E", "R Ib", "R Iz", "", "!-", "E G", "E G", "G E", "G E", "R Ib", "R Iz", "", "!-",
+    /* 40 */ "R", "R", "R", "R", "R", "R", "R", "R", "R", "R", "R", "R", "R", "R", "R", "R",
+    /* 50 */ "R", "R", "R", "R", "R", "R", "R", "R", "R", "R", "R", "R", "R", "R", "R", "R",
+    /* 60 */ "!-", "!-", "!G M", "E G", "", "", "", "", "Iz", "G E Iz", "Ib", "G E Ib", "-", "-", "-", "-",
+    /* 70 */ "Jb", "Jb", "Jb", "Jb", "Jb", "Jb", "Jb", "Jb", "Jb", "Jb", "Jb", "Jb", "Jb", "Jb", "Jb", "Jb",
+    /* 80 */ "E Ib", "E Iz", "!E Ib", "E Ib", "E G", "E G", "E G", "E G", "E G", "E G", "G E", "G E", "E G", "G M", "G E", "E",
+    /* 90 */ "-", "R R", "R R", "R R", "R R", "R R", "R R", "R R", "-", "-", "!Ap", "-", "-", "-", "-", "-",
+    /* A0 */ "R O", "R O", "O R", "O R", "P P", "P P", "P P", "P P", "R Ib", "R Iz", "P R", "P R", "R P", "R P", "R P", "R P",
+    /* B0 */ "R Ib", "R Ib", "R Ib", "R Ib", "R Ib", "R Ib", "R Ib", "R Ib", "R Iv", "R Iv", "R Iv", "R Iv", "R Iv", "R Iv", "R Iv", "R Iv",
+    /* C0 */ "E Ib", "E Ib", "Iw", "-", "!G M", "!G M", "E Ib", "E Iz", "Iw Ib", "-", "Iw", "-", "-", "Ib", "!-", "-",
+    /* D0 */ "E 1", "E 1", "E R", "E R", "!Ib", "!Ib", "!-", "-", "E", "E", "E", "E", "E", "E", "E", "E",
+    /* E0 */ "Jb", "Jb", "Jb", "Jb", "R Ib", "R Ib", "Ib R", "Ib R", "Jz", "Jz", "!Ap", "Jb", "R R", "R R", "R R", "R R",
+    /* F0 */ "", "-", "", "", "-", "-", "E", "E", "-", "-", "-", "-", "-", "-", "E", "E",
+};
+
+// 0F 30-37 are wrmsr, rdtsc, rdmsr, rdpmc, sysenter, sysexit, reserved and getsec. 0F 38 and 0F 3A are the three-byte escapes
+static const char* const TwoByteMap[256] = {
+    /* 00 */ "E", "E", "G E", "G E", "", "-", "-", "-", "-", "-", "", "-", "", "E", "-", "V W Ib",
+    /* 10 */ "V W", "W V", "V W", "W V", "V W", "V W", "V W", "W V", "E", "E", "E", "E", "E", "E", "E", "E",
+    /* 20 */ "E C", "E D", "C E", "D E", "!E T", "", "!T E", "", "V W", "W V", "V W", "W V", "G W", "G W", "V W", "V W",
+    /* 30 */ "-", "-", "-", "-", "-", "-", "", "-", "", "", "", "", "", "", "", "",
+    /* 40 */ "G E", "G E", "G E", "G E", "G E", "G E", "G E", "G E", "G E", "G E", "G E", "G E", "G E", "G E", "G E", "G E",
+    /* 50 */ "G U", "V W", "V W", "V W", "V W", "V W", "V W", "V W", "V W", "V W", "V W", "V W", "V W", "V W", "V W", "V W",
+    /* 60 */ "V W", "V W", "V W", "V W", "V W", "V W", "V W", "V W", "V W", "V W", "V W", "V W", "V W", "V W", "V E", "V W",
+    /* 70 */ "V W Ib", "U Ib", "U Ib", "U Ib", "V W", "V W", "V W", "-", "E G", "G E", "", "", "V W", "V W", "E V", "W V",
+    /* 80 */ "Jz", "Jz", "Jz", "Jz", "Jz", "Jz", "Jz", "Jz", "Jz", "Jz", "Jz", "Jz", "Jz", "Jz", "Jz", "Jz",
+    /* 90 */ "E", "E", "E", "E", "E", "E", "E", "E", "E", "E", "E", "E", "E", "E", "E", "E",
+    /* A0 */ "R", "R", "-", "E G", "E G Ib", "E G R", "", "", "R", "R", "-", "E G", "E G Ib", "E G R", "E", "G E",
+    /* B0 */ "E G", "E G", "G M", "E G", "G M", "G M", "G E", "G E", "G E", "G E", "E Ib", "E G", "G E", "G E", "G E", "G E",
+    /* C0 */ "E G", "E G", "V W Ib", "M G", "V E Ib", "G U Ib", "V W Ib", "E", "R", "R", "R", "R", "R", "R", "R", "R",
+    /* D0 */ "V W", "V W", "V W", "V W", "V W", "V W", "W V", "G U", "V W", "V W", "V W", "V W", "V W", "V W", "V W", "V W",
+    /* E0 */ "V W", "V W", "V W", "V W", "V W", "V W", "V W", "W V", "V W", "V W", "V W", "V W", "V W", "V W", "V W", "V W",
+    /* F0 */ "V W", "V W", "V W", "V W", "V W", "V W", "V W", "V U", "V W", "V W", "V W", "V W", "V W", "V W", "V W", "G E",
+};
+// clang-format on
+
+static OpcodeEntry ParseOpcodeEntry( const char* description ) {
+    OpcodeEntry entry{};
+    std::string_view text( description );
+    if( text.empty( ) ) {
+        return entry;
+    }
+
+    entry.valid = true;
+    if( text.front( ) == '!' ) {
+        entry.invalid64 = true;
+        text.remove_prefix( 1 );
+    }
+
+    while( !text.empty( ) && text != "-" ) {
+        auto end = text.find( ' ' );
+        const auto token = text.substr( 0, end );
+        text = end == std::string_view::npos ? std::string_view( ) : text.substr( end + 1 );
+
+        OperandKind kind = Kind_None;
+        if( token == "E" ) kind = Kind_E;
+        else if( token == "G" ) kind = Kind_G;
+        else if( token == "M" ) kind = Kind_M;
+        else if( token == "V" ) kind = Kind_V;
+        else if( token == "W" ) kind = Kind_W;
+        else if( token == "U" ) kind = Kind_U;
+        else if( token == "C" ) kind = Kind_C;
+        else if( token == "D" ) kind = Kind_D;
+        else if( token == "T" ) kind = Kind_T;
+        else if( token == "R" ) kind = Kind_R;
+        else if( token == "P" ) kind = Kind_P;
+        else if( token == "1" ) kind = Kind_One;
+        else if( token == "Ib" ) kind = Kind_Ib;
+        else if( token == "Iw" ) kind = Kind_Iw;
+        else if( token == "Iz" ) kind = Kind_Iz;
+        else if( token == "Iv" ) kind = Kind_Iv;
+        else if( token == "Id" ) kind = Kind_Id;
+        else if( token == "Jb" ) kind = Kind_Jb;
+        else if( token == "Jz" ) kind = Kind_Jz;
+        else if( token == "O" ) kind = Kind_O;
+        else if( token == "Ap" ) kind = Kind_Ap;
+
+        if( kind >= Kind_E && kind <= Kind_T ) {
+            entry.hasModRM = true;
+        }
+        if( entry.operandCount < 4 ) {
+            entry.operands[entry.operandCount++] = kind;
+        }
+    }
+    return entry;
+}
+
+struct OpcodeTables {
+    OpcodeTable oneByte;
+    OpcodeTable twoByte;
+    OpcodeTable threeByte38;
+    OpcodeTable threeByte3A;
+    OpcodeTable xop8;
+    OpcodeTable xop9;
+    OpcodeTable xopA;
+};
+
+static const OpcodeTables& GetOpcodeTables( ) {
+    static const OpcodeTables tables = []( ) {
+        OpcodeTables result{};
+        for( size_t i = 0; i < 256; i++ ) {
+            result.oneByte[i] = ParseOpcodeEntry( OneByteMap[i] );
+            result.twoByte[i] = ParseOpcodeEntry( TwoByteMap[i] );
+            // 0F 38 is vector code, except for the general purpose block at F0 (movbe, crc32, BMI)
+            result.threeByte38[i] = ParseOpcodeEntry( i >= 0xF0 ? "G E" : "V W" );
+            result.xop9[i] = ParseOpcodeEntry( "V W" );
+            result.xop8[i] = ParseOpcodeEntry( "V W Ib" );
+            result.xopA[i] = ParseOpcodeEntry( "V W Id" );
+        }
+        for( size_t i = 0; i < 256; i++ ) {
+            const char* description = "V W Ib";
+            switch( i ) {
+            case 0x14: case 0x15: case 0x16: case 0x17: // pextrb/w/d, extractps
+                description = "E V Ib";
+                break;
+            case 0x20: case 0x22: // pinsrb/d
+                description = "V E Ib";
+                break;
+            case 0xF0: // rorx
+                description = "G E Ib";
+                break;
+            }
+            result.threeByte3A[i] = ParseOpcodeEntry( description );
+        }
+        return result;
+    }( );
+    return tables;
+}
+
+// Opcodes whose vector operands are MMX registers when used without a mandatory prefix
+static bool IsMmxCapable( const OpcodeTable* table, const OpcodeTables& tables, uint8_t opcode ) {
+    if( table == &tables.twoByte ) {
+        return opcode == 0x0F || ( opcode >= 0x60 && opcode <= 0x7F && ( opcode < 0x78 || opcode > 0x7D ) ) || opcode == 0xC4 || opcode == 0xC5 || opcode >= 0xD0;
+    }
+    if( table == &tables.threeByte38 ) {
+        return opcode <= 0x0B || ( opcode >= 0x1C && opcode <= 0x1E );
+    }
+    if( table == &tables.threeByte3A ) {
+        return opcode == 0x0F;
+    }
+    return false;
+}
+
+bool DecodeX86Instruction( const uint8_t* bytes, size_t available, bool is64Bit, X86Instruction& instruction ) {
+    constexpr size_t MAX_INSTRUCTION_LENGTH = 15;
+
+    instruction = {};
+    const auto& tables = GetOpcodeTables( );
+    const auto limit = available < MAX_INSTRUCTION_LENGTH ? available : MAX_INSTRUCTION_LENGTH;
+    size_t position = 0;
+
+    // Legacy and REX prefixes
+    bool operandSize16 = false, addressSizeOverride = false, mandatoryPrefix = false;
+    uint8_t rex = 0;
+    while( position < limit ) {
+        const auto byte = bytes[position];
+        if( byte == 0x66 ) {
+            operandSize16 = true;
+        }
+        else if( byte == 0x67 ) {
+            addressSizeOverride = true;
+        }
+        else if( byte == 0xF2 || byte == 0xF3 ) {
+            mandatoryPrefix = true;
+        }
+        else if( is64Bit && ( byte & 0xF0 ) == 0x40 ) {
+            rex = byte;
+            position++;
+            continue;
+        }
+        else if( byte != 0xF0 && byte != 0x2E && byte != 0x36 && byte != 0x3E && byte != 0x26 && byte != 0x64 && byte != 0x65 ) {
+            break;
+        }
+        // REX only counts directly in front of the opcode
+        rex = 0;
+        position++;
+    }
+    if( position >= limit ) {
+        return false;
+    }
+
+    const bool rexW = rex & 0x08;
+    const uint8_t addressSize = is64Bit ? ( addressSizeOverride ? 32 : 64 ) : ( addressSizeOverride ? 16 : 32 );
+
+    // Opcode map, including the VEX, EVEX and XOP encodings
+    const OpcodeTable* table = &tables.oneByte;
+    uint8_t vectorType = X86_XmmReg;
+    bool isVex = false;
+    const auto first = bytes[position];
+    const bool hasNext = position + 1 < limit;
+    const auto next = hasNext ? bytes[position + 1] : 0;
+    if( ( first == 0xC4 || first == 0xC5 || first == 0x62 ) && hasNext && ( is64Bit || next >= 0xC0 ) ) {
+        isVex = true;
+        uint8_t map = 1;
+        if( first == 0xC5 ) {
+            if( next & 0x04 ) {
+                vectorType = X86_YmmReg;
+            }
+            position += 2;
+        }
+        else if( first == 0xC4 ) {
+            if( position + 2 >= limit ) {
+                return false;
+            }
+            map = next & 0x1F;
+            if( bytes[position + 2] & 0x04 ) {
+                vectorType = X86_YmmReg;
+            }
+            position += 3;
+        }
+        else {
+            if( position + 3 >= limit ) {
+                return false;
+            }
+            map = next & 0x07;
+            const auto vectorLength = ( bytes[position + 3] >> 5 ) & 3;
+            vectorType = vectorLength == 0 ? X86_XmmReg : ( vectorLength == 1 ? X86_YmmReg : X86_ZmmReg );
+            position += 4;
+        }
+
+        switch( map ) {
+        case 1:
+            table = &tables.twoByte;
+            break;
+        case 2:
+        case 5:
+        case 6:
+            table = &tables.threeByte38;
+            break;
+        case 3:
+            table = &tables.threeByte3A;
+            break;
+        default:
+            return false;
+        }
+    }
+    else if( first == 0x8F && hasNext && ( next & 0x1F ) >= 8 ) {
+        // AMD XOP, 8F /0 with a map select of 8 or above
+        if( position + 2 >= limit ) {
+            return false;
+        }
+        isVex = true;
+        if( bytes[position + 2] & 0x04 ) {
+            vectorType = X86_YmmReg;
+        }
+        switch( next & 0x1F ) {
+        case 8:
+            table = &tables.xop8;
+            break;
+        case 9:
+            table = &tables.xop9;
+            break;
+        case 10:
+            table = &tables.xopA;
+            break;
+        default:
+            return false;
+        }
+        position += 3;
+    }
+    else if( first == 0x0F ) {
+        position++;
+        table = &tables.twoByte;
+        if( position < limit && bytes[position] == 0x38 ) {
+            table = &tables.threeByte38;
+            position++;
+        }
+        else if( position < limit && bytes[position] == 0x3A ) {
+            table = &tables.threeByte3A;
+            position++;
+        }
+    }
+
+    if( position >= limit ) {
+        return false;
+    }
+    const auto opcode = bytes[position];
+    instruction.opcodeOffset = static_cast<uint8_t>( position );
+    position++;
+
+    auto entry = ( *table )[opcode];
+    if( !entry.valid || ( is64Bit && entry.invalid64 ) ) {
+        return false;
+    }
+
+    // movsxd replaces arpl in 64-bit mode
+    if( is64Bit && table == &tables.oneByte && opcode == 0x63 ) {
+        entry.operands[0] = Kind_G;
+        entry.operands[1] = Kind_E;
+    }
+
+    // Register classes
+    uint8_t generalType = X86_Reg;
+    uint8_t vectorRegisterType = vectorType;
+    if( !isVex && !operandSize16 && !mandatoryPrefix && IsMmxCapable( table, tables, opcode ) ) {
+        vectorRegisterType = X86_MmxReg;
+    }
+    // VEX encoded mask register instructions
+    if( isVex && table == &tables.twoByte && ( ( opcode >= 0x41 && opcode <= 0x4B ) || ( opcode >= 0x90 && opcode <= 0x93 ) || opcode == 0x98 || opcode == 0x99 ) ) {
+        generalType = X86_KReg;
+    }
+
+    // ModRM, SIB and displacement
+    uint8_t modrm = 0;
+    uint8_t memoryType = X86_Void, displacementOffset = 0, displacementSize = 0;
+    if( entry.hasModRM ) {
+        if( position >= limit ) {
+            return false;
+        }
+        modrm = bytes[position];
+        instruction.modrmOffset = static_cast<uint8_t>( position );
+        position++;
+
+        // mov to and from control, debug and test registers ignores mod, the r/m operand is always a register
+        const auto mod = table == &tables.twoByte && opcode >= 0x20 && opcode <= 0x26 ? 3 : modrm >> 6;
+        const auto rm = modrm & 7;
+        if( mod != 3 ) {
+            if( addressSize == 16 ) {
+                if( mod == 0 && rm == 6 ) {
+                    memoryType = X86_Mem;
+                    displacementSize = 2;
+                }
+                else {
+                    memoryType = mod == 0 ? X86_Phrase : X86_Displ;
+                    displacementSize = mod == 1 ? 1 : ( mod == 2 ? 2 : 0 );
+                }
+            }
+            else {
+                bool noBase = false;
+                if( rm == 4 ) {
+                    if( position >= limit ) {
+                        return false;
+                    }
+                    const auto sib = bytes[position];
+                    instruction.sibOffset = static_cast<uint8_t>( position );
+                    position++;
+                    noBase = mod == 0 && ( sib & 7 ) == 5;
+                }
+                else {
+                    // disp32, or rip-relative in 64-bit mode
+                    noBase = mod == 0 && rm == 5;
+                }
+
+                if( noBase ) {
+                    memoryType = X86_Mem;
+                    displacementSize = 4;
+                }
+                else {
+                    memoryType = mod == 0 ? X86_Phrase : X86_Displ;
+                    displacementSize = mod == 1 ? 1 : ( mod == 2 ? 4 : 0 );
+                }
+            }
+            displacementOffset = static_cast<uint8_t>( position );
+            position += displacementSize;
+        }
+
+        // Group 3 test has an immediate, the other group members do not
+        if( table == &tables.oneByte && ( opcode == 0xF6 || opcode == 0xF7 ) && ( ( modrm >> 3 ) & 7 ) <= 1 ) {
+            entry.operands[entry.operandCount++] = opcode == 0xF6 ? Kind_Ib : Kind_Iz;
+        }
+    }
+
+    // x87 register forms
+    const bool isX87 = table == &tables.oneByte && opcode >= 0xD8 && opcode <= 0xDF;
+    if( isX87 && ( modrm >> 6 ) == 3 ) {
+        // Forms without operands, like fld1 or fnop
+        if( ( opcode == 0xD9 && modrm >= 0xD0 ) || ( opcode == 0xDB && modrm >= 0xE0 && modrm <= 0xE7 ) || ( opcode == 0xDE && modrm == 0xD9 ) || ( opcode == 0xDA && modrm == 0xE9 ) ) {
+            entry.operandCount = 0;
+        }
+        else if( opcode == 0xDF && modrm == 0xE0 ) {
+            // fnstsw ax
+            entry.operands[0] = Kind_R;
+        }
+    }
+
+    // Registers encoded in the low bits of the opcode, the second operand for xchg
+    size_t opcodeRegisterIndex = entry.operandCount;
+    if( table == &tables.oneByte && ( ( opcode >= 0x40 && opcode <= 0x5F ) || ( opcode >= 0xB0 && opcode <= 0xBF ) ) ) {
+        opcodeRegisterIndex = 0;
+    }
+    else if( table == &tables.oneByte && opcode >= 0x91 && opcode <= 0x97 ) {
+        opcodeRegisterIndex = 1;
+    }
+    else if( table == &tables.twoByte && opcode >= 0xC8 ) {
+        opcodeRegisterIndex = 0;
+    }
+
+    // Operands in table order, immediates follow the displacement in the same order
+    for( size_t i = 0; i < entry.operandCount; i++ ) {
+        auto& operand = instruction.operands[instruction.operandCount];
+        operand = {};
+
+        size_t immediateSize = 0;
+        switch( entry.operands[i] ) {
+        case Kind_E:
+        case Kind_M:
+        case Kind_W:
+        case Kind_U:
+            if( memoryType != X86_Void ) {
+                operand.type = memoryType;
+                operand.offset = memoryType == X86_Phrase ? 0 : displacementOffset;
+                operand.size = memoryType == X86_Phrase ? 0 : displacementSize;
+            }
+            else if( entry.operands[i] == Kind_E || entry.operands[i] == Kind_M ) {
+                operand.type = isX87 ? static_cast<uint8_t>( X86_FpReg ) : generalType;
+            }
+            else {
+                operand.type = vectorRegisterType;
+            }
+            operand.field = X86_FieldModRMRm;
+            break;
+        case Kind_G:
+            operand.type = generalType;
+            operand.field = X86_FieldModRMReg;
+            break;
+        case Kind_V:
+            operand.type = vectorRegisterType;
+            operand.field = X86_FieldModRMReg;
+            break;
+        case Kind_C:
+            operand.type = X86_CrReg;
+            operand.field = X86_FieldModRMReg;
+            break;
+        case Kind_D:
+            operand.type = X86_DbReg;
+            operand.field = X86_FieldModRMReg;
+            break;
+        case Kind_T:
+            operand.type = X86_TrReg;
+            operand.field = X86_FieldModRMReg;
+            break;
+        case Kind_R:
+            operand.type = X86_Reg;
+            operand.field = i == opcodeRegisterIndex ? X86_FieldOpcode : X86_FieldNone;
+            break;
+        case Kind_P:
+            operand.type = X86_Phrase;
+            break;
+        case Kind_One:
+            operand.type = X86_Imm;
+            break;
+        case Kind_Ib:
+            operand.type = X86_Imm;
+            immediateSize = 1;
+            break;
+        case Kind_Iw:
+            operand.type = X86_Imm;
+            immediateSize = 2;
+            break;
+        case Kind_Iz:
+            operand.type = X86_Imm;
+            immediateSize = operandSize16 && !rexW && !isVex ? 2 : 4;
+            break;
+        case Kind_Iv:
+            operand.type = X86_Imm;
+            immediateSize = rexW ? 8 : ( operandSize16 ? 2 : 4 );
+            break;
+        case Kind_Id:
+            operand.type = X86_Imm;
+            immediateSize = 4;
+            break;
+        case Kind_Jb:
+            operand.type = X86_Near;
+            immediateSize = 1;
+            break;
+        case Kind_Jz:
+            operand.type = X86_Near;
+            immediateSize = is64Bit || !operandSize16 ? 4 : 2;
+            break;
+        case Kind_O:
+            operand.type = X86_Mem;
+            immediateSize = addressSize / 8;
+            break;
+        case Kind_Ap:
+            operand.type = X86_Far;
+            immediateSize = operandSize16 ? 4 : 6;
+            break;
+        default:
+            continue;
+        }
+
+        if( immediateSize > 0 ) {
+            operand.offset = static_cast<uint8_t>( position );
+            operand.size = static_cast<uint8_t>( immediateSize );
+            position += immediateSize;
+        }
+        instruction.operandCount++;
+    }
+
+    if( position > limit ) {
+        return false;
+    }
+    instruction.length = static_cast<uint8_t>( position );
+    return true;
+}
+
+bool GetX86OperandWildcard( const X86Instruction& instruction, uint32_t operandTypeBitmask, bool wildcardOptimizedInstruction, uint8_t& operandOffset, uint8_t& operandLength ) {
+    for( size_t i = 0; i < instruction.operandCount; i++ ) {
+        const auto& operand = instruction.operands[i];
+
+        // Apply operand bitmask filter
+        if( ( ( 1ULL << operand.type ) & operandTypeBitmask ) == 0 ) {
+            continue;
+        }
+
+        // The operand is part of the operator and can't be described by its offset
+        if( operand.offset == 0 && !wildcardOptimizedInstruction ) {
+            continue;
+        }
+
+        operandOffset = operand.offset;
+        operandLength = static_cast<uint8_t>( instruction.length - operand.offset );
+        return true;
+    }
+    return false;
+}
+
+void GetX86OperandMatchMasks( const X86Instruction& instruction, uint32_t operandTypeBitmask, uint8_t* matchMasks ) {
+    std::memset( matchMasks, 0xFF, instruction.length );
+
+    for( size_t i = 0; i < instruction.operandCount; i++ ) {
+        const auto& operand = instruction.operands[i];
+        if( ( ( 1ULL << operand.type ) & operandTypeBitmask ) == 0 ) {
+            continue;
+        }
+
+        // Immediates, displacements and addresses
+        if( operand.offset != 0 ) {
+            std::memset( matchMasks + operand.offset, 0, operand.size );
+            continue;
+        }
+
+        switch( operand.field ) {
+        case X86_FieldOpcode:
+            matchMasks[instruction.opcodeOffset] &= 0xF8;
+            break;
+        case X86_FieldModRMReg:
+            matchMasks[instruction.modrmOffset] &= 0xC7;
+            break;
+        case X86_FieldModRMRm:
+            // rm = 100 only selects the SIB byte, its base and index are the registers
+            if( instruction.sibOffset != 0 ) {
+                matchMasks[instruction.sibOffset] &= 0xC0;
+            }
+            else {
+                matchMasks[instruction.modrmOffset] &= 0xF8;
+            }
+            break;
+        }
+    }
+}
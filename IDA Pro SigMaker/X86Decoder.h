@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Operand types, numbered like IDA's optype_t and the intel.hpp extensions, so the same wildcard bitmask applies
+enum X86OperandType : uint8_t {
+    X86_Void = 0,
+    X86_Reg = 1,
+    X86_Mem = 2,
+    X86_Phrase = 3,
+    X86_Displ = 4,
+    X86_Imm = 5,
+    X86_Far = 6,
+    X86_Near = 7,
+    X86_TrReg = 8,
+    X86_DbReg = 9,
+    X86_CrReg = 10,
+    X86_FpReg = 11,
+    X86_MmxReg = 12,
+    X86_XmmReg = 13,
+    X86_YmmReg = 14,
+    X86_ZmmReg = 15,
+    X86_KReg = 16
+};
+
+// Where a register operand is encoded
+enum X86RegisterField : uint8_t {
+    X86_FieldNone = 0,
+    X86_FieldOpcode,   // Low 3 bits of the opcode, like push rbx
+    X86_FieldModRMReg, // ModRM.reg
+    X86_FieldModRMRm,  // ModRM.rm, or the SIB base and index for memory operands without displacement
+};
+
+struct X86Operand {
+    uint8_t type;
+    // Offset of the operand's bytes in the instruction, 0 if it is encoded in the opcode or implied (like insn_t::ops[].offb)
+    uint8_t offset;
+    // Amount of bytes at offset, e.g. of the immediate or displacement
+    uint8_t size;
+    uint8_t field;
+};
+
+struct X86Instruction {
+    uint8_t length = 0;
+    // Offset of the (last) opcode byte, the ModRM and the SIB byte, 0 if there is none
+    uint8_t opcodeOffset = 0;
+    uint8_t modrmOffset = 0;
+    uint8_t sibOffset = 0;
+    uint8_t operandCount = 0;
+    X86Operand operands[4] = {};
+};
+
+// Decode an instruction from raw bytes without IDA, so it can run on any thread
+// Only lengths, operand types and operand offsets are computed. Returns false for invalid or truncated instructions
+bool DecodeX86Instruction( const uint8_t* bytes, size_t available, bool is64Bit, X86Instruction& instruction );
+
+// Wildcard range the plugin computes from IDA's decoder: the first operand whose type is set in the bitmask, up to the end of the instruction
+// Operands encoded in the opcode (offset 0) are only used if wildcardOptimizedInstruction is set
+bool GetX86OperandWildcard( const X86Instruction& instruction, uint32_t operandTypeBitmask, bool wildcardOptimizedInstruction, uint8_t& operandOffset, uint8_t& operandLength );
+
+// Tighter wildcards for bit-level signatures: bits of every instruction byte that have to match
+// Operand bytes are wildcarded completely, registers only by their field in the opcode, ModRM or SIB byte
+void GetX86OperandMatchMasks( const X86Instruction& instruction, uint32_t operandTypeBitmask, uint8_t* matchMasks );